@@ -0,0 +1,71 @@
+#ifndef ARCHETYPES_H
+#define ARCHETYPES_H
+
+#include "game.h"
+
+// Everything that sets one kind of asteroid apart, fixed at compile time and
+// indexed by AsteroidType. A new kind is an enum value and a row here. The
+// size is the atlas sprite's; the renderer may replace it, and the hull,
+// with what it actually loaded.
+struct AsteroidArchetype {
+    // Name in the sprite atlas, and the standalone image used without it.
+    const char *sprite;
+    const char *texture;
+    int width;
+    int height;
+    // Spawned moving Range(10) * speed and spinning Range(10) * spin per tick.
+    float speed;
+    float spin;
+    int score;
+    // Destroying one spawns splitCount of splitInto, flying off at
+    // Range(10) * splitSpeed with alternating signs.
+    AsteroidType splitInto;
+    int splitCount;
+    float splitSpeed;
+};
+
+constexpr AsteroidArchetype ASTEROID_ARCHETYPES[ASTEROID_TYPES] = {
+    // BIG
+    {"meteorBrown_big1.png", "assets/PNG/Meteors/meteorBrown_big1.png", 101, 84, 0.1f, 0.05f, 10, MEDIUM, 2, 0.3f},
+    // MEDIUM
+    {"meteorBrown_med1.png", "assets/PNG/Meteors/meteorBrown_med1.png", 43, 43, 0.3f, 0.05f, 50, SMALL, 2, 0.3f},
+    // SMALL
+    {"meteorBrown_tiny1.png", "assets/PNG/Meteors/meteorBrown_tiny1.png", 18, 18, 0.5f, 0.1f, 100, SMALL, 0, 0.0f},
+};
+
+template<AsteroidType T>
+constexpr const AsteroidArchetype &archetype()
+{
+    static_assert(T < ASTEROID_TYPES, "not an asteroid archetype");
+    return ASTEROID_ARCHETYPES[T];
+}
+
+// True when every split chain ends within ASTEROID_TYPES steps.
+constexpr bool splitsTerminate()
+{
+    for(int t=0; t < ASTEROID_TYPES; t++)
+    {
+        int type = t;
+        int steps = 0;
+        while(ASTEROID_ARCHETYPES[type].splitCount > 0)
+        {
+            type = ASTEROID_ARCHETYPES[type].splitInto;
+            if(++steps > ASTEROID_TYPES) return false;
+        }
+    }
+    return true;
+}
+
+static_assert(splitsTerminate(), "an asteroid archetype splits forever");
+
+// Most asteroids one of type can turn into at once. A fragment replaces its
+// parent in the same tick, so that is the number of leaves.
+constexpr int asteroidFragments(AsteroidType type)
+{
+    return ASTEROID_ARCHETYPES[type].splitCount == 0 ? 1 :
+           ASTEROID_ARCHETYPES[type].splitCount * asteroidFragments(ASTEROID_ARCHETYPES[type].splitInto);
+}
+
+static_assert(MAX_BIG_ASTEROIDS * asteroidFragments(BIG) <= MAX_ASTEROIDS, "MAX_ASTEROIDS cannot hold a full wave's fragments");
+
+#endif
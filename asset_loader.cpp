@@ -0,0 +1,186 @@
+#include "asset_loader.h"
+#include <SDL2/SDL_image.h>
+#include <string.h>
+
+AssetLoader::AssetLoader(int threads)
+{
+    mNext = 0;
+    mRunning = true;
+    mFinished = 0;
+    mSteps = 0;
+    for(int i=0; i < threads; i++)
+    {
+        mWorkers.emplace_back(&AssetLoader::WorkerLoop, this);
+    }
+}
+
+AssetLoader::~AssetLoader()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mRunning = false;
+    }
+    mWake.notify_all();
+    for(auto &worker : mWorkers)
+    {
+        worker.join();
+    }
+    for(auto &request : mRequests)
+    {
+        SDL_FreeSurface(request->surface);
+        if(request->font != nullptr) TTF_CloseFont(request->font);
+        Mix_FreeChunk(request->chunk);
+    }
+}
+
+void AssetLoader::Image(const char *path)
+{
+    Queue(path, ASSET_IMAGE, 0);
+}
+
+void AssetLoader::Font(const char *path, int size)
+{
+    Queue(path, ASSET_FONT, size);
+}
+
+void AssetLoader::Sound(const char *path)
+{
+    Queue(path, ASSET_SOUND, 0);
+}
+
+void AssetLoader::Queue(const char *path, Kind kind, int fontSize)
+{
+    std::unique_ptr<Request> request(new Request());
+    request->path = path;
+    request->kind = kind;
+    request->fontSize = fontSize;
+    request->surface = nullptr;
+    request->font = nullptr;
+    request->chunk = nullptr;
+    request->state = ASSET_QUEUED;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mRequests.push_back(std::move(request));
+        // Images are decoded and then uploaded; the rest are only decoded.
+        mSteps += kind == ASSET_IMAGE ? 2 : 1;
+    }
+    mWake.notify_one();
+}
+
+void AssetLoader::WorkerLoop()
+{
+    while(true)
+    {
+        Request *request;
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mWake.wait(lock, [this] { return !mRunning || mNext < mRequests.size(); });
+            if(!mRunning) return;
+            request = mRequests[mNext++].get();
+        }
+        Decode(request);
+    }
+}
+
+void AssetLoader::Decode(Request *request)
+{
+    if(request->kind == ASSET_FONT)
+    {
+        request->font = TTF_OpenFont(request->path.c_str(), request->fontSize);
+        if(request->font == nullptr)
+        {
+            SDL_Log("Unable to load font %s! SDL_ttf Error: %s\n", request->path.c_str(), TTF_GetError());
+        }
+        request->state = ASSET_DONE;
+        mFinished++;
+        return;
+    }
+    if(request->kind == ASSET_SOUND)
+    {
+        request->chunk = Mix_LoadWAV(request->path.c_str());
+        if(request->chunk == nullptr)
+        {
+            SDL_Log("Unable to load sound %s! SDL_mixer Error: %s\n", request->path.c_str(), Mix_GetError());
+        }
+        request->state = ASSET_DONE;
+        mFinished++;
+        return;
+    }
+
+    // Converted once here so CPU readers can assume the byte layout.
+    SDL_Surface *loaded = IMG_Load(request->path.c_str());
+    if(loaded == nullptr)
+    {
+        SDL_Log("Unable to load image %s! SDL_image Error: %s\n", request->path.c_str(), IMG_GetError());
+    }
+    else
+    {
+        request->surface = SDL_ConvertSurfaceFormat(loaded, SDL_PIXELFORMAT_RGBA32, 0);
+        SDL_FreeSurface(loaded);
+    }
+    request->state = ASSET_DECODED;
+    mFinished++;
+}
+
+void AssetLoader::Upload(TextureCache *cache, double budgetMs)
+{
+    Uint64 frequency = SDL_GetPerformanceFrequency();
+    Uint64 start = SDL_GetPerformanceCounter();
+    for(auto &request : mRequests)
+    {
+        if(request->state.load() != ASSET_DECODED) continue;
+        if(request->surface != nullptr)
+        {
+            cache->Adopt(request->path.c_str(), request->surface);
+        }
+        request->state = ASSET_DONE;
+        mFinished++;
+        if((SDL_GetPerformanceCounter() - start) * 1000.0 / frequency >= budgetMs) break;
+    }
+}
+
+float AssetLoader::Progress() const
+{
+    return mSteps == 0 ? 1.0f : (float)mFinished.load() / mSteps;
+}
+
+bool AssetLoader::Done() const
+{
+    return mFinished.load() >= mSteps;
+}
+
+AssetLoader::Request *AssetLoader::Find(const char *path, Kind kind) const
+{
+    for(auto &request : mRequests)
+    {
+        if(request->kind == kind && request->path == path && request->state.load() == ASSET_DONE)
+        {
+            return request.get();
+        }
+    }
+    return nullptr;
+}
+
+SDL_Surface *AssetLoader::Surface(const char *path) const
+{
+    Request *request = Find(path, ASSET_IMAGE);
+    return request ? request->surface : nullptr;
+}
+
+TTF_Font *AssetLoader::TakeFont(const char *path)
+{
+    Request *request = Find(path, ASSET_FONT);
+    if(request == nullptr) return nullptr;
+    TTF_Font *font = request->font;
+    request->font = nullptr;
+    return font;
+}
+
+Mix_Chunk *AssetLoader::TakeSound(const char *path)
+{
+    Request *request = Find(path, ASSET_SOUND);
+    if(request == nullptr) return nullptr;
+    Mix_Chunk *chunk = request->chunk;
+    request->chunk = nullptr;
+    return chunk;
+}
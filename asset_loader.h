@@ -0,0 +1,87 @@
+#ifndef ASSET_LOADER_H
+#define ASSET_LOADER_H
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+#include <SDL2/SDL_mixer.h>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "texture_cache.h"
+
+// Decodes images, fonts and sounds on worker threads, so the render thread only
+// pays for the texture uploads, a few per frame. Queue everything, then
+// call Upload every frame until Done. Apart from the workers, the loader
+// belongs to the thread that created it.
+class AssetLoader
+{
+    public:
+        AssetLoader(int threads);
+        // Waits for the workers and frees anything decoded but not taken.
+        ~AssetLoader();
+
+        void Image(const char *path);
+        void Font(const char *path, int size);
+        // Needs the mixer open, since chunks are converted to its format.
+        void Sound(const char *path);
+
+        // Turns decoded images into resident textures in cache until budgetMs
+        // has passed. Render thread only.
+        void Upload(TextureCache *cache, double budgetMs);
+
+        // Fraction of the queued work decoded and uploaded.
+        float Progress() const;
+        bool Done() const;
+
+        // The decoded RGBA32 copy of an uploaded image, for reading pixels on
+        // the CPU; nullptr if it failed to load. Valid until the loader is
+        // destroyed.
+        SDL_Surface *Surface(const char *path) const;
+        // Hands over a loaded font; nullptr if it failed.
+        TTF_Font *TakeFont(const char *path);
+        Mix_Chunk *TakeSound(const char *path);
+
+    private:
+        enum Kind {
+            ASSET_IMAGE,
+            ASSET_FONT,
+            ASSET_SOUND,
+        };
+
+        enum State {
+            ASSET_QUEUED,
+            ASSET_DECODED,
+            ASSET_DONE,
+        };
+
+        struct Request {
+            std::string path;
+            Kind kind;
+            int fontSize;
+            SDL_Surface *surface;
+            TTF_Font *font;
+            Mix_Chunk *chunk;
+            std::atomic<int> state;
+        };
+
+        void Queue(const char *path, Kind kind, int fontSize);
+        Request *Find(const char *path, Kind kind) const;
+        void WorkerLoop();
+        void Decode(Request *request);
+
+        std::vector<std::unique_ptr<Request>> mRequests;
+        std::vector<std::thread> mWorkers;
+        std::mutex mMutex;
+        std::condition_variable mWake;
+        size_t mNext;
+        bool mRunning;
+        // Steps finished: one per decode and one per image upload.
+        std::atomic<int> mFinished;
+        int mSteps;
+};
+
+#endif
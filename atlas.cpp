@@ -0,0 +1,258 @@
+#include "atlas.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BATCH_RESERVE_QUADS 1024
+#define DEG_TO_RAD (3.14159265f / 180.0f)
+
+static bool readAttribute(const char *tag, const char *end, const char *attribute, std::string &value)
+{
+    size_t length = strlen(attribute);
+    for(const char *p = tag; p + length + 2 < end; p++)
+    {
+        if(strncmp(p, attribute, length) == 0 && p[length] == '=' && p[length+1] == '"' && (p == tag || p[-1] == ' ' || p[-1] == '\t'))
+        {
+            const char *start = p + length + 2;
+            const char *close = (const char*)memchr(start, '"', end - start);
+            if(close == nullptr) return false;
+            value.assign(start, close - start);
+            return true;
+        }
+    }
+    return false;
+}
+
+Atlas::Atlas(TextureCache *textures)
+{
+    mTextures = textures;
+    mTexture = nullptr;
+}
+
+Atlas::~Atlas()
+{
+    for(auto &sprite : mFallbacks)
+    {
+        mTextures->Release(sprite->texture);
+        delete sprite;
+    }
+    mFallbacks.clear();
+    mTextures->Release(mTexture);
+    mTexture = nullptr;
+}
+
+bool Atlas::Load(const char *xmlPath)
+{
+    return Parse(xmlPath) && Bind();
+}
+
+bool Atlas::Parse(const char *xmlPath)
+{
+    FILE *file = fopen(xmlPath, "rb");
+    if(file == nullptr)
+    {
+        SDL_Log("Unable to open atlas %s\n", xmlPath);
+        return false;
+    }
+    std::string xml;
+    char buffer[4096];
+    size_t n;
+    while((n = fread(buffer, 1, sizeof(buffer), file)) > 0)
+    {
+        xml.append(buffer, n);
+    }
+    fclose(file);
+
+    const char *begin = xml.c_str();
+    const char *end = begin + xml.size();
+
+    const char *atlasTag = strstr(begin, "<TextureAtlas");
+    std::string imagePath;
+    if(atlasTag == nullptr || !readAttribute(atlasTag, end, "imagePath", imagePath))
+    {
+        SDL_Log("Atlas %s has no imagePath\n", xmlPath);
+        return false;
+    }
+
+    // imagePath is relative to the XML file.
+    std::string path = xmlPath;
+    size_t slash = path.find_last_of('/');
+    mImagePath = (slash == std::string::npos) ? imagePath : path.substr(0, slash + 1) + imagePath;
+
+    std::string name, x, y, w, h;
+    for(const char *tag = strstr(atlasTag, "<SubTexture"); tag != nullptr; tag = strstr(tag + 1, "<SubTexture"))
+    {
+        const char *close = strchr(tag, '>');
+        if(close == nullptr) break;
+        if(!readAttribute(tag, close, "name", name) || !readAttribute(tag, close, "x", x) ||
+           !readAttribute(tag, close, "y", y) || !readAttribute(tag, close, "width", w) ||
+           !readAttribute(tag, close, "height", h))
+        {
+            SDL_Log("Skipping malformed SubTexture in %s\n", xmlPath);
+            continue;
+        }
+        Sprite sprite;
+        sprite.texture = nullptr;
+        sprite.src = {atoi(x.c_str()), atoi(y.c_str()), atoi(w.c_str()), atoi(h.c_str())};
+        mSprites[name] = sprite;
+    }
+
+    SDL_Log("Loaded %zu sprites from %s\n", mSprites.size(), xmlPath);
+    return true;
+}
+
+bool Atlas::Bind()
+{
+    mTexture = mTextures->Acquire(mImagePath.c_str());
+    if(mTexture == nullptr)
+    {
+        mSprites.clear();
+        return false;
+    }
+    SDL_SetTextureBlendMode(mTexture->texture, SDL_BLENDMODE_BLEND);
+    for(auto &sprite : mSprites)
+    {
+        sprite.second.texture = mTexture;
+    }
+    return true;
+}
+
+const Sprite *Atlas::Find(const char *name, const char *fallbackPath)
+{
+    auto it = mSprites.find(name);
+    if(it != mSprites.end())
+    {
+        return &it->second;
+    }
+
+    SDL_Log("Sprite %s not in atlas, falling back to %s\n", name, fallbackPath);
+    Texture *texture = mTextures->Acquire(fallbackPath);
+    if(texture == nullptr)
+    {
+        return nullptr;
+    }
+    Sprite *sprite = new Sprite();
+    sprite->texture = texture;
+    sprite->src = {0, 0, texture->width, texture->height};
+    mFallbacks.push_back(sprite);
+    return sprite;
+}
+
+bool ReadSpriteAlpha(const Sprite *sprite, SDL_Surface *image, std::vector<Uint8> &alpha)
+{
+    if(sprite == nullptr || image == nullptr) return false;
+
+    SDL_Rect src = sprite->src;
+    alpha.assign((size_t)src.w * src.h, 0);
+    SDL_LockSurface(image);
+    for(int y=0; y < src.h; y++)
+    {
+        if(src.y + y < 0 || src.y + y >= image->h) continue;
+        const Uint8 *row = (const Uint8*)image->pixels + (size_t)(src.y + y) * image->pitch;
+        for(int x=0; x < src.w; x++)
+        {
+            if(src.x + x < 0 || src.x + x >= image->w) continue;
+            // RGBA32 is byte order R, G, B, A whatever the endianness.
+            alpha[(size_t)y * src.w + x] = row[(src.x + x) * 4 + 3];
+        }
+    }
+    SDL_UnlockSurface(image);
+    return true;
+}
+
+SpriteBatch::SpriteBatch(SDL_Renderer *renderer)
+{
+    mRenderer = renderer;
+    mTexture = nullptr;
+    mRegions = nullptr;
+    mSubmissions = 0;
+    mVertices.reserve(BATCH_RESERVE_QUADS * 4);
+    mIndices.reserve(BATCH_RESERVE_QUADS * 6);
+}
+
+void SpriteBatch::Draw(const Sprite *sprite, const SDL_Rect &dst, float angle)
+{
+    if(sprite == nullptr) return;
+
+    SDL_Texture *texture = sprite->texture->texture;
+    if(texture != mTexture)
+    {
+        Flush();
+        mTexture = texture;
+    }
+
+    float texW = (float)sprite->texture->width;
+    float texH = (float)sprite->texture->height;
+    float u0 = sprite->src.x / texW;
+    float v0 = sprite->src.y / texH;
+    float u1 = (sprite->src.x + sprite->src.w) / texW;
+    float v1 = (sprite->src.y + sprite->src.h) / texH;
+
+    float halfW = dst.w * 0.5f;
+    float halfH = dst.h * 0.5f;
+    float cx = dst.x + halfW;
+    float cy = dst.y + halfH;
+    float c = cosf(angle * DEG_TO_RAD);
+    float s = sinf(angle * DEG_TO_RAD);
+
+    const float corners[4][4] = {
+        {-halfW, -halfH, u0, v0},
+        { halfW, -halfH, u1, v0},
+        { halfW,  halfH, u1, v1},
+        {-halfW,  halfH, u0, v1},
+    };
+
+    int base = (int)mVertices.size();
+    for(int i=0; i < 4; i++)
+    {
+        SDL_Vertex vertex;
+        vertex.position.x = cx + corners[i][0] * c - corners[i][1] * s;
+        vertex.position.y = cy + corners[i][0] * s + corners[i][1] * c;
+        vertex.color = {255, 255, 255, 255};
+        vertex.tex_coord.x = corners[i][2];
+        vertex.tex_coord.y = corners[i][3];
+        mVertices.push_back(vertex);
+    }
+    if(mRegions != nullptr) mRegions->AddQuad(&mVertices[base]);
+    mIndices.push_back(base);
+    mIndices.push_back(base + 1);
+    mIndices.push_back(base + 2);
+    mIndices.push_back(base);
+    mIndices.push_back(base + 2);
+    mIndices.push_back(base + 3);
+}
+
+void SpriteBatch::DrawQuads(SDL_Texture *texture, const SDL_Vertex *vertices, int quads)
+{
+    if(texture != mTexture)
+    {
+        Flush();
+        mTexture = texture;
+    }
+
+    int base = (int)mVertices.size();
+    mVertices.insert(mVertices.end(), vertices, vertices + quads * 4);
+    for(int i=0; i < quads; i++, base += 4)
+    {
+        if(mRegions != nullptr) mRegions->AddQuad(&mVertices[base]);
+        mIndices.push_back(base);
+        mIndices.push_back(base + 1);
+        mIndices.push_back(base + 2);
+        mIndices.push_back(base);
+        mIndices.push_back(base + 2);
+        mIndices.push_back(base + 3);
+    }
+}
+
+void SpriteBatch::Flush()
+{
+    if(!mIndices.empty())
+    {
+        SDL_RenderGeometry(mRenderer, mTexture, mVertices.data(), (int)mVertices.size(), mIndices.data(), (int)mIndices.size());
+        mSubmissions++;
+    }
+    mVertices.clear();
+    mIndices.clear();
+    mTexture = nullptr;
+}
@@ -0,0 +1,101 @@
+#ifndef ATLAS_H
+#define ATLAS_H
+
+#include <SDL2/SDL.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "texture_cache.h"
+#include "dirty_regions.h"
+
+struct Sprite {
+    Texture *texture;
+    SDL_Rect src;
+};
+
+// Name -> rect table parsed from a TextureAtlas XML file (the format Kenney
+// ships in assets/Spritesheet). Lookups allocate, so resolve sprites once at
+// startup and keep the returned pointers.
+class Atlas
+{
+    public:
+        Atlas(TextureCache *textures);
+        ~Atlas();
+
+        // Parse then Bind.
+        bool Load(const char *xmlPath);
+        // Reads the sprite rects only, so the sheet image can be decoded
+        // elsewhere before Bind acquires it from the cache.
+        bool Parse(const char *xmlPath);
+        bool Bind();
+        const char *ImagePath() const
+        {
+            return mImagePath.c_str();
+        }
+        bool Has(const char *name) const
+        {
+            return mSprites.find(name) != mSprites.end();
+        }
+
+        // Returns the named sprite, or a sprite covering the whole of
+        // fallbackPath when the atlas is missing or does not contain name.
+        const Sprite *Find(const char *name, const char *fallbackPath);
+
+    private:
+        TextureCache *mTextures;
+        Texture *mTexture;
+        std::string mImagePath;
+        std::unordered_map<std::string, Sprite> mSprites;
+        std::vector<Sprite*> mFallbacks;
+};
+
+// Copies the alpha channel of sprite's rect out of image, the RGBA32 surface
+// its texture was made from, one byte per pixel, row by row. Meant for
+// load-time work such as building collision hulls; textures cannot be read
+// back cheaply.
+bool ReadSpriteAlpha(const Sprite *sprite, SDL_Surface *image, std::vector<Uint8> &alpha);
+
+// Collects rotated quads and submits them with SDL_RenderGeometry. Quads are
+// only split into a new submission when the texture changes, so everything
+// drawn from the atlas goes out in a single call per frame.
+class SpriteBatch
+{
+    public:
+        SpriteBatch(SDL_Renderer *renderer);
+
+        // angle is in degrees clockwise around the centre of dst, matching
+        // SDL_RenderCopyEx.
+        void Draw(const Sprite *sprite, const SDL_Rect &dst, float angle);
+        // Append pre-built quads, four vertices each in clockwise order.
+        void DrawQuads(SDL_Texture *texture, const SDL_Vertex *vertices, int quads);
+        void Flush();
+
+        // Record the bounds of every quad from now on in regions, or stop
+        // with nullptr.
+        void Track(DirtyRegions *regions)
+        {
+            mRegions = regions;
+        }
+
+        // Record a region drawn straight to the renderer.
+        void Touch(const SDL_Rect &rect)
+        {
+            if(mRegions != nullptr) mRegions->Add(rect);
+        }
+
+        Uint32 Submissions() const
+        {
+            return mSubmissions;
+        }
+
+    private:
+        SDL_Renderer *mRenderer;
+        SDL_Texture *mTexture;
+        std::vector<SDL_Vertex> mVertices;
+        std::vector<int> mIndices;
+        DirtyRegions *mRegions;
+
+        Uint32 mSubmissions;
+};
+
+#endif
@@ -0,0 +1,113 @@
+#include "audio.h"
+
+#define AUDIO_FREQUENCY 44100
+#define AUDIO_CHANNELS 2
+#define AUDIO_BUFFER 1024
+
+struct SoundInfo {
+    const char *path;
+    // Most copies that may play at once.
+    int voices;
+    int volume;
+};
+
+static const SoundInfo SOUNDS[SOUND_COUNT] = {
+    // SOUND_LASER
+    {"assets/Bonus/sfx_laser1.ogg", 4, MIX_MAX_VOLUME / 2},
+    // SOUND_EXPLOSION
+    {"assets/Bonus/sfx_zap.ogg", 4, MIX_MAX_VOLUME},
+    // SOUND_SHIP_DESTROYED
+    {"assets/Bonus/sfx_lose.ogg", 1, MIX_MAX_VOLUME},
+};
+
+Audio::Audio()
+{
+    mOpen = false;
+    mDropped = 0;
+    for(auto &chunk : mChunks)
+    {
+        chunk = nullptr;
+    }
+}
+
+bool Audio::Open()
+{
+    Mix_Init(MIX_INIT_OGG);
+    if(Mix_OpenAudio(AUDIO_FREQUENCY, MIX_DEFAULT_FORMAT, AUDIO_CHANNELS, AUDIO_BUFFER) < 0)
+    {
+        SDL_Log("Unable to open audio! SDL_mixer Error: %s\n", Mix_GetError());
+        return false;
+    }
+
+    // Channels [first, first + voices) are tagged with the sound's id.
+    int channels = 0;
+    for(const SoundInfo &sound : SOUNDS)
+    {
+        channels += sound.voices;
+    }
+    Mix_AllocateChannels(channels);
+    int first = 0;
+    for(int s=0; s < SOUND_COUNT; s++)
+    {
+        Mix_GroupChannels(first, first + SOUNDS[s].voices - 1, s);
+        first += SOUNDS[s].voices;
+    }
+    mOpen = true;
+    return true;
+}
+
+void Audio::Close()
+{
+    if(mOpen)
+    {
+        Mix_HaltChannel(-1);
+    }
+    for(auto &chunk : mChunks)
+    {
+        Mix_FreeChunk(chunk);
+        chunk = nullptr;
+    }
+    if(mOpen)
+    {
+        Mix_CloseAudio();
+        mOpen = false;
+    }
+    Mix_Quit();
+}
+
+void Audio::Load(AssetLoader &loader)
+{
+    if(!mOpen) return;
+    for(const SoundInfo &sound : SOUNDS)
+    {
+        loader.Sound(sound.path);
+    }
+}
+
+void Audio::Take(AssetLoader &loader)
+{
+    for(int s=0; s < SOUND_COUNT; s++)
+    {
+        mChunks[s] = mOpen ? loader.TakeSound(SOUNDS[s].path) : nullptr;
+        if(mChunks[s] != nullptr)
+        {
+            Mix_VolumeChunk(mChunks[s], SOUNDS[s].volume);
+        }
+    }
+}
+
+void Audio::Play(SoundQueue &queue)
+{
+    SoundId sound;
+    while(queue.Pop(sound))
+    {
+        if(mChunks[sound] == nullptr) continue;
+        int channel = Mix_GroupAvailable(sound);
+        if(channel < 0)
+        {
+            mDropped++;
+            continue;
+        }
+        Mix_PlayChannel(channel, mChunks[sound], 0);
+    }
+}
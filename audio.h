@@ -0,0 +1,39 @@
+#ifndef AUDIO_H
+#define AUDIO_H
+
+#include <SDL2/SDL_mixer.h>
+#include "asset_loader.h"
+#include "simulation.h"
+
+// Plays the simulation's sounds through SDL_mixer. Every sound owns a fixed
+// group of channels allocated when the device opens, so however many are
+// requested at once, no channel is ever added at runtime and at most that
+// many copies of a sound mix together; requests beyond it are dropped.
+class Audio
+{
+    public:
+        Audio();
+
+        // False when there is no audio device; Play then only drains.
+        bool Open();
+        void Close();
+
+        // Queue every sound on loader, and take the chunks once it is done.
+        void Load(AssetLoader &loader);
+        void Take(AssetLoader &loader);
+
+        // Starts everything queued since the last call.
+        void Play(SoundQueue &queue);
+
+        Uint32 Dropped() const
+        {
+            return mDropped;
+        }
+
+    private:
+        bool mOpen;
+        Mix_Chunk *mChunks[SOUND_COUNT];
+        Uint32 mDropped;
+};
+
+#endif
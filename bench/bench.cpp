@@ -0,0 +1,462 @@
+// Runs the simulation headless for a fixed number of ticks with scripted
+// input and reports throughput, tick time percentiles and heap allocations.
+// Any allocation after warmup fails the run.
+// With --replay it instead fast-forwards a recorded game and checks it
+// reproduces the recorded state checksums.
+// --stress N and --stress-bullets N switch the simulation to stress mode,
+// and --report FILE appends one tab-separated line per run, so reports from
+// `make bench-scaling` can be diffed between builds.
+// --savestate then times capturing and restoring the final state and checks
+// that ticks run on from a restore match the ones run from the capture.
+// --players N with N above 1 then plays on through a rollback session with
+// players 1 and up behind a loopback link (--latency MS, --jitter MS,
+// --loss FRACTION), reports what the mispredictions cost and checks the
+// result matches running the same input without prediction.
+// --tuning FILE plays with the values from FILE instead of the defaults and
+// reports what parsing it cost. A replay runs with the tuning it was
+// recorded with.
+#include <algorithm>
+#include <chrono>
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "../simulation.h"
+#include "../integrate.h"
+#include "../replay.h"
+#include "../jobs.h"
+#include "../savestate.h"
+#include "../rollback.h"
+
+static size_t sAllocations = 0;
+
+void *operator new(size_t size)
+{
+    sAllocations++;
+    void *p = malloc(size ? size : 1);
+    if(p == nullptr) throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    free(p);
+}
+
+// A fixed pattern that turns, thrusts and fires, and restarts after a game
+// over, so every run exercises the same code paths.
+static void scriptInput(int tick)
+{
+    if(!gIsGameStarted)
+    {
+        queueInput({INPUT_FIRE, 1});
+        queueInput({INPUT_FIRE, 0});
+        return;
+    }
+    if(gGameOver)
+    {
+        queueInput({INPUT_RESTART, 1});
+        queueInput({INPUT_RESTART, 0});
+        return;
+    }
+
+    int phase = tick % 120;
+    if(phase == 0) queueInput({INPUT_LEFT, 1});
+    if(phase == 20) queueInput({INPUT_LEFT, 0});
+    if(phase == 40) queueInput({INPUT_THRUST, 1});
+    if(phase == 55) queueInput({INPUT_THRUST, 0});
+    if(phase == 70) queueInput({INPUT_RIGHT, 1});
+    if(phase == 80) queueInput({INPUT_RIGHT, 0});
+    if(tick % 8 == 0) queueInput({INPUT_FIRE, 1});
+    if(tick % 8 == 1) queueInput({INPUT_FIRE, 0});
+}
+
+#define SAVESTATE_ROUNDS 100
+#define SAVESTATE_CHECK_TICKS 120
+
+// False on an allocation or when the restored run diverges.
+static bool benchSaveState(int nextTick)
+{
+    SaveState state;
+    state.Reserve();
+    size_t allocationsBefore = sAllocations;
+
+    auto start = std::chrono::steady_clock::now();
+    for(int i=0; i < SAVESTATE_ROUNDS; i++)
+    {
+        state.Capture();
+    }
+    auto captured = std::chrono::steady_clock::now();
+    bool restored = true;
+    for(int i=0; i < SAVESTATE_ROUNDS; i++)
+    {
+        restored &= state.Restore();
+    }
+    auto end = std::chrono::steady_clock::now();
+    size_t allocations = sAllocations - allocationsBefore;
+
+    double captureUs = std::chrono::duration<double, std::micro>(captured - start).count() / SAVESTATE_ROUNDS;
+    double restoreUs = std::chrono::duration<double, std::micro>(end - captured).count() / SAVESTATE_ROUNDS;
+
+    for(int i=0; i < SAVESTATE_CHECK_TICKS; i++)
+    {
+        scriptInput(nextTick + i);
+        tick();
+    }
+    uint32_t expected = stateChecksum();
+    restored &= state.Restore();
+    for(int i=0; i < SAVESTATE_CHECK_TICKS; i++)
+    {
+        scriptInput(nextTick + i);
+        tick();
+    }
+    bool identical = restored && stateChecksum() == expected;
+
+    printf("save state       %zu bytes\n", state.Bytes());
+    printf("capture          %.2f us (%.3f%% of a tick)\n", captureUs, captureUs / (TICK_INTERVAL * 10.0));
+    printf("restore          %.2f us (%.3f%% of a tick)\n", restoreUs, restoreUs / (TICK_INTERVAL * 10.0));
+    printf("save allocations %zu\n", allocations);
+    printf("restored run     %s over %d ticks\n", identical ? "identical" : "MISMATCH", SAVESTATE_CHECK_TICKS);
+    return identical && allocations == 0;
+}
+
+#define ROLLBACK_TICKS 2000
+
+// Held buttons as a function of tick and player only, so the run through
+// the session and the plain run see the same input whatever was predicted.
+// Player 0 restarts now and then, which only counts after a game over.
+static InputBits scriptBits(uint32_t tick, int player)
+{
+    int phase = (tick + player * 37) % 120;
+    InputBits bits = 0;
+    if(phase < 20) bits |= 1 << INPUT_LEFT;
+    if(phase >= 40 && phase < 55) bits |= 1 << INPUT_THRUST;
+    if(phase >= 70 && phase < 80) bits |= 1 << INPUT_RIGHT;
+    if((tick + player) % 8 == 0) bits |= 1 << INPUT_FIRE;
+    if(player == 0 && tick % 240 == 0) bits |= 1 << INPUT_RESTART;
+    return bits;
+}
+
+// False on an allocation or when the session's result differs from the
+// plain run.
+static bool benchRollback(double latency, double jitter, double loss, uint64_t seed)
+{
+    SaveState initial;
+    initial.Reserve();
+    initial.Capture();
+    uint32_t firstTick = gTick;
+
+    LoopbackTransport toSession;
+    LoopbackTransport toPeer;
+    toSession.Configure(latency, jitter, loss, seed + 1);
+    toPeer.Configure(latency, jitter, loss, seed + 2);
+    RollbackSession session;
+    InputSender peer;
+    session.Start(1, &toSession, &toPeer);
+    peer.Start(((1u << gShipCount) - 1) & ~1u, gTick);
+
+    size_t allocationsBefore = sAllocations;
+    auto start = std::chrono::steady_clock::now();
+    InputBits bits[MAX_SHIPS];
+    double now = 0.0;
+    for(int run=0; run < ROLLBACK_TICKS; now += TICK_INTERVAL)
+    {
+        for(int p=0; p < gShipCount; p++)
+        {
+            bits[p] = scriptBits(gTick, p);
+        }
+        peer.Record(gTick, bits);
+        peer.Flush(&toSession, &toPeer, now);
+        if(session.Advance(bits, now)) run++;
+    }
+    // Let the last input arrive and the last mispredictions be corrected.
+    while(!session.Confirmed())
+    {
+        peer.Flush(&toSession, &toPeer, now);
+        session.Poll(now);
+        now += TICK_INTERVAL;
+    }
+    auto end = std::chrono::steady_clock::now();
+    size_t allocations = sAllocations - allocationsBefore;
+    uint32_t predicted = stateChecksum();
+    uint32_t lastTick = gTick;
+
+    bool restored = initial.Restore();
+    for(uint32_t t=firstTick; t < lastTick; t++)
+    {
+        for(int p=0; p < gShipCount; p++)
+        {
+            InputBits before = t > firstTick ? scriptBits(t - 1, p) : 0;
+            InputBits changed = before ^ scriptBits(t, p);
+            for(int action=0; action <= INPUT_RESTART; action++)
+            {
+                if(changed & (1 << action)) queueInput({(uint8_t)action, (uint8_t)((scriptBits(t, p) >> action) & 1), (uint8_t)p});
+            }
+        }
+        tick();
+    }
+    bool identical = restored && stateChecksum() == predicted;
+
+    const RollbackStats &stats = session.Stats();
+    double gameSeconds = stats.ticks * TICK_INTERVAL / 1000.0;
+    double seconds = std::chrono::duration<double>(end - start).count();
+    printf("rollback players %d, latency %.0f ms, jitter %.0f ms, loss %.0f%%\n", gShipCount, latency, jitter, loss * 100.0);
+    printf("rollbacks        %llu, deepest %u ticks, %llu stalls\n", (unsigned long long)stats.rollbacks, stats.deepest,
+           (unsigned long long)stats.stalls);
+    printf("resimulated      %llu ticks, %.1f per game second\n", (unsigned long long)stats.resimulated,
+           gameSeconds > 0 ? stats.resimulated / gameSeconds : 0.0);
+    printf("rollback cpu     %.2f%% resimulating, %.2f%% simulating, of real time\n",
+           gameSeconds > 0 ? stats.resimulateSeconds * 100.0 / gameSeconds : 0.0,
+           gameSeconds > 0 ? stats.simulateSeconds * 100.0 / gameSeconds : 0.0);
+    printf("rollback run     %.1f ms for %llu ticks\n", seconds * 1000.0, (unsigned long long)stats.ticks);
+    printf("packets          %llu sent, %llu dropped\n", (unsigned long long)(toSession.Sent() + toPeer.Sent()),
+           (unsigned long long)(toSession.Dropped() + toPeer.Dropped()));
+    printf("rollback allocs  %zu\n", allocations);
+    printf("rollback result  %s over %u ticks\n", identical ? "identical" : "MISMATCH", lastTick - firstTick);
+    return identical && allocations == 0;
+}
+
+static double percentile(std::vector<double> &sorted, double p)
+{
+    if(sorted.empty()) return 0.0;
+    size_t i = (size_t)(p * (sorted.size() - 1) + 0.5);
+    return sorted[i];
+}
+
+int main(int argc, char **argv)
+{
+    int ticks = 20000;
+    int warmup = 1000;
+    uint64_t seed = 1;
+    const char *recordPath = nullptr;
+    const char *replayPath = nullptr;
+    int threads = 1;
+    const char *reportPath = nullptr;
+    bool saveStates = false;
+    double latency = 100.0;
+    double jitter = 0.0;
+    double loss = 0.0;
+    const char *tuningPath = nullptr;
+    for(int i=1; i < argc; i++)
+    {
+        if(strcmp(argv[i], "--ticks") == 0 && i + 1 < argc)
+        {
+            ticks = atoi(argv[++i]);
+        }
+        else if(strcmp(argv[i], "--warmup") == 0 && i + 1 < argc)
+        {
+            warmup = atoi(argv[++i]);
+        }
+        else if(strcmp(argv[i], "--check-collisions") == 0)
+        {
+            gCheckCollisions = true;
+        }
+        else if(strcmp(argv[i], "--scalar") == 0)
+        {
+            SetIntegrateBackend(INTEGRATE_SCALAR);
+        }
+        else if(strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+        {
+            threads = atoi(argv[++i]);
+        }
+        else if(strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+        {
+            seed = strtoull(argv[++i], nullptr, 10);
+        }
+        else if(strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+        {
+            recordPath = argv[++i];
+        }
+        else if(strcmp(argv[i], "--replay") == 0 && i + 1 < argc)
+        {
+            replayPath = argv[++i];
+        }
+        else if(strcmp(argv[i], "--stress") == 0 && i + 1 < argc)
+        {
+            gStressAsteroids = strtoull(argv[++i], nullptr, 10);
+        }
+        else if(strcmp(argv[i], "--stress-bullets") == 0 && i + 1 < argc)
+        {
+            gStressBullets = strtoull(argv[++i], nullptr, 10);
+        }
+        else if(strcmp(argv[i], "--report") == 0 && i + 1 < argc)
+        {
+            reportPath = argv[++i];
+        }
+        else if(strcmp(argv[i], "--savestate") == 0)
+        {
+            saveStates = true;
+        }
+        else if(strcmp(argv[i], "--tuning") == 0 && i + 1 < argc)
+        {
+            tuningPath = argv[++i];
+        }
+        else if(strcmp(argv[i], "--players") == 0 && i + 1 < argc)
+        {
+            gShipCount = atoi(argv[++i]);
+        }
+        else if(strcmp(argv[i], "--latency") == 0 && i + 1 < argc)
+        {
+            latency = atof(argv[++i]);
+        }
+        else if(strcmp(argv[i], "--jitter") == 0 && i + 1 < argc)
+        {
+            jitter = atof(argv[++i]);
+        }
+        else if(strcmp(argv[i], "--loss") == 0 && i + 1 < argc)
+        {
+            loss = atof(argv[++i]);
+        }
+    }
+
+    // Reloading in the game goes through the same path, so this is the
+    // cost of a live change.
+    double tuningUs = 0.0;
+    size_t tuningAllocations = 0;
+    if(tuningPath != nullptr)
+    {
+        size_t before = sAllocations;
+        auto start = std::chrono::steady_clock::now();
+        bool loaded = LoadTuning(tuningPath, gTuning);
+        tuningUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        tuningAllocations = sAllocations - before;
+        if(!loaded) return 1;
+    }
+
+    ReplayRecorder recorder;
+    ReplayPlayer player;
+    if(replayPath != nullptr)
+    {
+        if(!player.Open(replayPath)) return 1;
+        seed = player.Seed();
+        gTuning = player.GetTuning();
+        gPlayer = &player;
+        // Every recorded tick is timed; there is no separate warmup.
+        warmup = 0;
+        ticks = (int)player.EndTick();
+    }
+    else if(recordPath != nullptr)
+    {
+        if(!recorder.Open(recordPath, seed, gTuning)) return 1;
+        gRecorder = &recorder;
+    }
+    gRng.Seed(seed);
+
+    gJobs.Start(threads);
+    initSimulation();
+
+    for(int i=0; i < warmup; i++)
+    {
+        if(gPlayer == nullptr) scriptInput(i);
+        tick();
+    }
+
+    std::vector<double> times;
+    times.reserve(ticks);
+    size_t entities = 0;
+    size_t allocationsBefore = sAllocations;
+
+    auto start = std::chrono::steady_clock::now();
+    for(int i=0; i < ticks; i++)
+    {
+        auto tickStart = std::chrono::steady_clock::now();
+        if(gPlayer == nullptr) scriptInput(warmup + i);
+        tick();
+        auto tickEnd = std::chrono::steady_clock::now();
+        times.push_back(std::chrono::duration<double, std::micro>(tickEnd - tickStart).count());
+        entities += gAsteroids.Size() + gBullets.Size();
+    }
+    auto end = std::chrono::steady_clock::now();
+    size_t allocations = sAllocations - allocationsBefore;
+
+    double seconds = std::chrono::duration<double>(end - start).count();
+    std::sort(times.begin(), times.end());
+
+    double averageEntities = ticks ? (double)entities / ticks : 0.0;
+    // Memory is what the pools, grid and ghost list hold for their
+    // capacity, per slot.
+    double asteroidBytes = (double)(gAsteroids.Memory() + gAsteroidGrid.Memory() + gAsteroidGhosts.Memory()) / gAsteroids.stats.capacity;
+    double bulletBytes = (double)gBullets.Memory() / gBullets.stats.capacity;
+
+    printf("backend          %s\n", IntegrateBackendName(GetIntegrateBackend()));
+    printf("threads          %d\n", gJobs.Threads());
+    printf("ticks            %d (after %d warmup)\n", ticks, warmup);
+    printf("ticks/sec        %.0f\n", ticks / seconds);
+    printf("tick p50         %.2f us\n", percentile(times, 0.50));
+    printf("tick p99         %.2f us\n", percentile(times, 0.99));
+    printf("tick max         %.2f us\n", times.empty() ? 0.0 : times.back());
+    printf("allocations      %zu (%.3f per tick)\n", allocations, ticks ? (double)allocations / ticks : 0.0);
+    printf("asteroid pool    peak %zu of %zu, %zu refused\n", gAsteroids.stats.peak, gAsteroids.stats.capacity, gAsteroids.stats.refused);
+    printf("bullet pool      peak %zu of %zu, %zu refused\n", gBullets.stats.peak, gBullets.stats.capacity, gBullets.stats.refused);
+    printf("entities         %.0f average\n", averageEntities);
+    printf("memory           %.1f B per asteroid (grid and ghosts included), %.1f B per bullet\n", asteroidBytes, bulletBytes);
+    printf("final wave       %d, score %d\n", gWave, gScore);
+    printf("seed             %llu\n", (unsigned long long)seed);
+    printf("checksum         %08x\n", stateChecksum());
+    if(tuningPath != nullptr)
+    {
+        printf("tuning           %s, %.1f us to load, %zu allocations\n", tuningPath, tuningUs, tuningAllocations);
+    }
+    if(gPlayer != nullptr)
+    {
+        if(gDesyncTick == NO_DESYNC) printf("replay           in sync\n");
+        else printf("replay           desync at tick %u\n", gDesyncTick);
+    }
+
+    if(reportPath != nullptr)
+    {
+        FILE *report = fopen(reportPath, "a");
+        if(report == nullptr)
+        {
+            fprintf(stderr, "Unable to open %s\n", reportPath);
+            return 1;
+        }
+        if(ftell(report) == 0)
+        {
+            fprintf(report, "stress\tbullets\tthreads\tentities\tticks/sec\tp50 us\tp99 us\tB/asteroid\tB/bullet\tchecksum\n");
+        }
+        fprintf(report, "%zu\t%zu\t%d\t%.0f\t%.0f\t%.2f\t%.2f\t%.1f\t%.1f\t%08x\n", gStressAsteroids, gStressBullets,
+                gJobs.Threads(), averageEntities, ticks / seconds, percentile(times, 0.50), percentile(times, 0.99),
+                asteroidBytes, bulletBytes, stateChecksum());
+        fclose(report);
+    }
+
+    // Runs more ticks, so not against a recording or a replay.
+    bool saveStatesPassed = true;
+    if(saveStates && gRecorder == nullptr && gPlayer == nullptr)
+    {
+        saveStatesPassed = benchSaveState(warmup + ticks);
+    }
+    bool rollbackPassed = true;
+    if(gShipCount > 1 && gRecorder == nullptr && gPlayer == nullptr)
+    {
+        rollbackPassed = benchRollback(latency, jitter, loss, seed);
+    }
+
+    recorder.Close(gTick);
+    gRecorder = nullptr;
+    gPlayer = nullptr;
+
+    clear();
+    gJobs.Stop();
+
+    // The pools are sized up front, so gameplay itself must never allocate,
+    // and neither may a tuning reload.
+    if(tuningAllocations != 0)
+    {
+        fprintf(stderr, "%zu heap allocations loading the tuning\n", tuningAllocations);
+        return 1;
+    }
+    if(allocations != 0)
+    {
+        fprintf(stderr, "%zu heap allocations during steady-state ticks\n", allocations);
+        return 1;
+    }
+    return gDesyncTick == NO_DESYNC && saveStatesPassed && rollbackPassed ? 0 : 1;
+}
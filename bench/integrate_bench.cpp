@@ -0,0 +1,96 @@
+// Times the integration kernels over synthetic asteroid and bullet fields
+// and checks that every backend matches the scalar one bit for bit.
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "../game.h"
+#include "../integrate.h"
+
+#define ITERATIONS 200
+// Timed runs per backend, after one untimed warm-up; the fastest counts.
+#define ROUNDS 5
+
+struct Field {
+    std::vector<float> x, y, angle, vx, vy, rotation;
+};
+
+static Field makeField(size_t count)
+{
+    Field field;
+    srand(1234);
+    for(size_t i=0; i < count; i++)
+    {
+        field.x.push_back(rand() % (WIDTH + 200) - 100);
+        field.y.push_back(rand() % (HEIGHT + 200) - 100);
+        field.angle.push_back(rand() % 360);
+        field.vx.push_back((rand() % 20 - 10) * 0.3f);
+        field.vy.push_back((rand() % 20 - 10) * 0.3f);
+        field.rotation.push_back(rand() % 10 * 0.05f);
+    }
+    return field;
+}
+
+static double run(Field &field, size_t count)
+{
+    auto start = std::chrono::steady_clock::now();
+    for(int i=0; i < ITERATIONS; i++)
+    {
+        IntegrateAsteroids(field.x.data(), field.y.data(), field.angle.data(), field.vx.data(), field.vy.data(),
+                           field.rotation.data(), count, WIDTH, HEIGHT);
+        IntegrateBullets(field.x.data(), field.y.data(), field.vx.data(), field.vy.data(), count);
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / ITERATIONS / count;
+}
+
+// The warm-up keeps whichever backend runs first from being charged for
+// faulting in the pages and warming the caches. Every round but the last
+// runs on a copy, so field still ends up integrated exactly once.
+static double bestRun(Field &field, size_t count)
+{
+    Field warm = field;
+    run(warm, count);
+    double best = 0.0;
+    for(int i=0; i < ROUNDS; i++)
+    {
+        Field copy = field;
+        double ns = run(i + 1 < ROUNDS ? copy : field, count);
+        if(i == 0 || ns < best) best = ns;
+    }
+    return best;
+}
+
+int main(int, char**)
+{
+    const size_t counts[] = {10000, 100000};
+    const IntegrateBackend backends[] = {INTEGRATE_SCALAR, INTEGRATE_SSE2, INTEGRATE_AVX2};
+    int failures = 0;
+
+    for(size_t count : counts)
+    {
+        Field reference = makeField(count);
+        SetIntegrateBackend(INTEGRATE_SCALAR);
+        double scalar = bestRun(reference, count);
+
+        for(IntegrateBackend backend : backends)
+        {
+            if(!SetIntegrateBackend(backend))
+            {
+                printf("%7zu entities  %-6s  unsupported\n", count, IntegrateBackendName(backend));
+                continue;
+            }
+            Field field = makeField(count);
+            double ns = bestRun(field, count);
+            bool exact = memcmp(field.x.data(), reference.x.data(), count * sizeof(float)) == 0 &&
+                         memcmp(field.y.data(), reference.y.data(), count * sizeof(float)) == 0 &&
+                         memcmp(field.angle.data(), reference.angle.data(), count * sizeof(float)) == 0;
+            if(!exact) failures++;
+            printf("%7zu entities  %-6s  %6.3f ns/entity  %5.2fx  %s\n", count, IntegrateBackendName(backend),
+                   ns, scalar / ns, exact ? "exact" : "MISMATCH");
+        }
+    }
+
+    return failures == 0 ? 0 : 1;
+}
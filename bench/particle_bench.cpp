@@ -0,0 +1,104 @@
+// Holds the particle system at a fixed number of live particles and times
+// each frame's update and vertex build against a budget, gating on the
+// median of several warmed-up rounds. Submitting the vertices to the GPU
+// needs a renderer and is not timed here.
+#include <algorithm>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "../particles.h"
+
+#define CAPACITY 65536
+#define WARMUP_FRAMES 120
+#define FRAMES 600
+#define ROUNDS 5
+#define FRAME_MS (1000.0f / 60.0f)
+
+// Debris bursts spread over the screen until target particles are live, the
+// way a busy wave keeps the system fed.
+static void topUp(ParticleSystem &particles, size_t target, int &burst)
+{
+    // Live only counts at an Update, so emit what is missing and recount.
+    while(particles.Live() < target)
+    {
+        size_t missing = target - particles.Live();
+        for(size_t emitted=0; emitted < missing; burst++)
+        {
+            Effect effect = {(EffectKind)(EFFECT_DEBRIS + burst % ASTEROID_TYPES), (float)(burst * 37 % WIDTH),
+                             (float)(burst * 91 % HEIGHT), 1.0f, -1.0f, 0.0f};
+            particles.Emit(effect);
+            emitted += EMITTERS[effect.kind].count;
+        }
+        particles.Update(0.0f);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    size_t target = 50000;
+    // The per-frame target is 2 ms; the gate leaves headroom for a noisy
+    // machine and the measured value is printed either way.
+    double budget = 3.0;
+    for(int i=1; i < argc; i++)
+    {
+        if(strcmp(argv[i], "--particles") == 0 && i + 1 < argc)
+        {
+            target = strtoull(argv[++i], nullptr, 10);
+        }
+        else if(strcmp(argv[i], "--budget") == 0 && i + 1 < argc)
+        {
+            budget = atof(argv[++i]);
+        }
+    }
+
+    ParticleSystem particles(CAPACITY);
+    std::vector<ParticleVertex> vertices(CAPACITY * 4);
+    std::vector<double> times;
+    times.reserve(FRAMES);
+    std::vector<double> p99s;
+    std::vector<double> means;
+
+    // Each frame updates, which kills the oldest, then is topped back up
+    // before the build, so every timed build emits the full target.
+    // Emitting is left out of the time; it depends on how the bursts land.
+    int burst = 0;
+    size_t quads = 0;
+    size_t fewest = CAPACITY;
+    for(int round=0; round < ROUNDS; round++)
+    {
+        times.clear();
+        for(int frame=0; frame < WARMUP_FRAMES + FRAMES; frame++)
+        {
+            auto start = std::chrono::steady_clock::now();
+            particles.Update(FRAME_MS);
+            auto updated = std::chrono::steady_clock::now();
+            topUp(particles, target, burst);
+            auto built = std::chrono::steady_clock::now();
+            quads = particles.Build(vertices.data());
+            auto end = std::chrono::steady_clock::now();
+            if(frame < WARMUP_FRAMES) continue;
+            fewest = std::min(fewest, quads);
+            times.push_back(std::chrono::duration<double, std::milli>((updated - start) + (end - built)).count());
+        }
+
+        std::sort(times.begin(), times.end());
+        double total = 0.0;
+        for(double t : times) total += t;
+        means.push_back(total / times.size());
+        p99s.push_back(times[times.size() * 99 / 100]);
+    }
+
+    // The median round, so one disturbed round neither fails nor flatters.
+    std::sort(p99s.begin(), p99s.end());
+    std::sort(means.begin(), means.end());
+    double p99 = p99s[ROUNDS / 2];
+    printf("particles  %zu live target, at least %zu drawn per timed frame, capacity %d, %zu KB\n",
+           target, fewest, CAPACITY, particles.Memory() / 1024);
+    printf("frame      update + build, median of %d rounds: mean %.3f ms  p99 %.3f ms (rounds %.3f to %.3f)\n",
+           ROUNDS, means[ROUNDS / 2], p99, p99s.front(), p99s.back());
+    printf("           excludes submitting the vertices with SDL_RenderGeometry\n");
+    printf("budget     %.3f ms  %s\n", budget, p99 <= budget ? "ok" : "OVER BUDGET");
+    return p99 <= budget ? 0 : 1;
+}
@@ -0,0 +1,240 @@
+#include "collision.h"
+#include <math.h>
+#include <algorithm>
+#include <vector>
+
+static float cross(Vector2 o, Vector2 a, Vector2 b)
+{
+    return (a.x - o.x) * (b.y - o.y) - (a.y - o.y) * (b.x - o.x);
+}
+
+static float polygonArea(const Vector2 *points, int count)
+{
+    float area = 0.0f;
+    for(int i=0; i < count; i++)
+    {
+        Vector2 a = points[i];
+        Vector2 b = points[(i + 1) % count];
+        area += a.x * b.y - b.x * a.y;
+    }
+    return fabsf(area) * 0.5f;
+}
+
+static void finishHull(Hull &hull)
+{
+    hull.radius = 0.0f;
+    for(int i=0; i < hull.count; i++)
+    {
+        hull.radius = std::max(hull.radius, sqrtf(hull.points[i].x * hull.points[i].x + hull.points[i].y * hull.points[i].y));
+    }
+    hull.area = polygonArea(hull.points, hull.count);
+}
+
+Hull RectHull(float width, float height)
+{
+    Hull hull;
+    hull.count = 4;
+    hull.points[0] = Vector2(-width / 2, -height / 2);
+    hull.points[1] = Vector2(width / 2, -height / 2);
+    hull.points[2] = Vector2(width / 2, height / 2);
+    hull.points[3] = Vector2(-width / 2, height / 2);
+    finishHull(hull);
+    return hull;
+}
+
+Hull BuildHull(const uint8_t *alpha, int width, int height, uint8_t threshold, float scaleX, float scaleY)
+{
+    // The outer corners of each row's first and last opaque pixel are
+    // enough to pin down the hull of every opaque pixel.
+    std::vector<Vector2> points;
+    for(int y=0; y < height; y++)
+    {
+        int left = -1;
+        int right = -1;
+        for(int x=0; x < width; x++)
+        {
+            if(alpha[y * width + x] >= threshold)
+            {
+                if(left < 0) left = x;
+                right = x;
+            }
+        }
+        if(left < 0) continue;
+        points.push_back(Vector2(left, y));
+        points.push_back(Vector2(left, y + 1));
+        points.push_back(Vector2(right + 1, y));
+        points.push_back(Vector2(right + 1, y + 1));
+    }
+    if(points.empty())
+    {
+        return RectHull(width * scaleX, height * scaleY);
+    }
+
+    // Andrew's monotone chain, counter-clockwise in screen coordinates.
+    std::sort(points.begin(), points.end(), [](Vector2 a, Vector2 b) {
+        return a.x < b.x || (a.x == b.x && a.y < b.y);
+    });
+    std::vector<Vector2> hull(points.size() * 2);
+    size_t k = 0;
+    for(size_t i=0; i < points.size(); i++)
+    {
+        while(k >= 2 && cross(hull[k-2], hull[k-1], points[i]) <= 0) k--;
+        hull[k++] = points[i];
+    }
+    for(size_t i=points.size() - 1, lower=k + 1; i-- > 0;)
+    {
+        while(k >= lower && cross(hull[k-2], hull[k-1], points[i]) <= 0) k--;
+        hull[k++] = points[i];
+    }
+    hull.resize(k - 1);
+
+    // Drop the vertex whose removal costs the least area until the hull
+    // fits. The result is slightly inside the true hull.
+    while(hull.size() > HULL_MAX_POINTS)
+    {
+        size_t best = 0;
+        float bestArea = INFINITY;
+        for(size_t i=0; i < hull.size(); i++)
+        {
+            Vector2 prev = hull[(i + hull.size() - 1) % hull.size()];
+            Vector2 next = hull[(i + 1) % hull.size()];
+            float area = fabsf(cross(prev, hull[i], next));
+            if(area < bestArea)
+            {
+                bestArea = area;
+                best = i;
+            }
+        }
+        hull.erase(hull.begin() + best);
+    }
+
+    Hull result;
+    result.count = (int)hull.size();
+    for(int i=0; i < result.count; i++)
+    {
+        result.points[i] = Vector2((hull[i].x - width * 0.5f) * scaleX, (hull[i].y - height * 0.5f) * scaleY);
+    }
+    finishHull(result);
+    return result;
+}
+
+void TransformHull(const Hull &hull, float cx, float cy, float angle, Polygon &out)
+{
+    // Same rotation SpriteBatch::Draw applies to the quad corners.
+    float c = cosf(angle * (float)PI / 180.0f);
+    float s = sinf(angle * (float)PI / 180.0f);
+    out.count = hull.count;
+    for(int i=0; i < hull.count; i++)
+    {
+        Vector2 p = hull.points[i];
+        out.points[i] = Vector2(cx + p.x * c - p.y * s, cy + p.x * s + p.y * c);
+    }
+}
+
+static bool separated(float nx, float ny, float cx, float cy, float radius, const Polygon &polygon)
+{
+    float length = sqrtf(nx * nx + ny * ny);
+    if(length == 0.0f) return false;
+    nx /= length;
+    ny /= length;
+
+    float lo = INFINITY;
+    float hi = -INFINITY;
+    for(int i=0; i < polygon.count; i++)
+    {
+        float d = polygon.points[i].x * nx + polygon.points[i].y * ny;
+        lo = std::min(lo, d);
+        hi = std::max(hi, d);
+    }
+    float centre = cx * nx + cy * ny;
+    return centre + radius < lo || centre - radius > hi;
+}
+
+bool CircleOverlapsPolygon(float cx, float cy, float radius, const Polygon &polygon)
+{
+    // Candidate axes: every edge normal, plus the direction from the
+    // nearest vertex to the centre, which covers the vertex regions.
+    float nearest = INFINITY;
+    Vector2 vertex;
+    for(int i=0; i < polygon.count; i++)
+    {
+        Vector2 a = polygon.points[i];
+        Vector2 b = polygon.points[(i + 1) % polygon.count];
+        if(separated(b.y - a.y, a.x - b.x, cx, cy, radius, polygon)) return false;
+
+        float dx = cx - a.x;
+        float dy = cy - a.y;
+        float distance = dx * dx + dy * dy;
+        if(distance < nearest)
+        {
+            nearest = distance;
+            vertex = a;
+        }
+    }
+    return !separated(cx - vertex.x, cy - vertex.y, cx, cy, radius, polygon);
+}
+
+bool SweepCircleAgainstPolygon(float cx, float cy, float radius, float dx, float dy, const Polygon &polygon, float &time)
+{
+    if(CircleOverlapsPolygon(cx, cy, radius, polygon))
+    {
+        time = 0.0f;
+        return true;
+    }
+
+    // The centre's path against the polygon grown by radius: each edge
+    // pushed out along its normal, and a circle around each vertex.
+    float ox = 0.0f;
+    float oy = 0.0f;
+    for(int i=0; i < polygon.count; i++)
+    {
+        ox += polygon.points[i].x;
+        oy += polygon.points[i].y;
+    }
+    ox /= polygon.count;
+    oy /= polygon.count;
+
+    float best = INFINITY;
+    for(int i=0; i < polygon.count; i++)
+    {
+        Vector2 a = polygon.points[i];
+        Vector2 b = polygon.points[(i + 1) % polygon.count];
+        float length = sqrtf((b.x - a.x) * (b.x - a.x) + (b.y - a.y) * (b.y - a.y));
+        if(length > 0.0f)
+        {
+            float ex = (b.x - a.x) / length;
+            float ey = (b.y - a.y) / length;
+            float nx = ey;
+            float ny = -ex;
+            if(((a.x + b.x) * 0.5f - ox) * nx + ((a.y + b.y) * 0.5f - oy) * ny < 0)
+            {
+                nx = -nx;
+                ny = -ny;
+            }
+            float distance = (cx - a.x) * nx + (cy - a.y) * ny - radius;
+            float speed = dx * nx + dy * ny;
+            if(speed < 0 && distance >= 0 && distance < -speed * best)
+            {
+                float t = distance / -speed;
+                float along = (cx + dx * t - a.x) * ex + (cy + dy * t - a.y) * ey;
+                if(along >= 0 && along <= length) best = t;
+            }
+        }
+
+        float fx = cx - a.x;
+        float fy = cy - a.y;
+        float qa = dx * dx + dy * dy;
+        float qb = 2 * (fx * dx + fy * dy);
+        float qc = fx * fx + fy * fy - radius * radius;
+        float discriminant = qb * qb - 4 * qa * qc;
+        if(qa > 0 && discriminant >= 0)
+        {
+            float t = (-qb - sqrtf(discriminant)) / (2 * qa);
+            if(t >= 0 && t < best) best = t;
+        }
+    }
+
+    if(best > 1.0f) return false;
+    time = best;
+    return true;
+}
@@ -0,0 +1,43 @@
+#ifndef COLLISION_H
+#define COLLISION_H
+
+#include <stdint.h>
+#include "game.h"
+
+#define HULL_MAX_POINTS 8
+
+// Convex outline of a sprite's opaque pixels, in entity pixels relative to
+// the entity's centre and unrotated. radius is the farthest point from the
+// centre, so a box of +-radius holds the hull at any rotation.
+struct Hull {
+    int count;
+    Vector2 points[HULL_MAX_POINTS];
+    float radius;
+    float area;
+};
+
+// A hull placed in the world: rotated and moved to its entity's centre.
+struct Polygon {
+    int count;
+    Vector2 points[HULL_MAX_POINTS];
+};
+
+// Hull of the pixels in a width x height alpha mask at or above threshold,
+// scaled by scaleX/scaleY from sprite to entity pixels and reduced to at most
+// HULL_MAX_POINTS vertices. Falls back to the full rectangle when the mask
+// is empty.
+Hull BuildHull(const uint8_t *alpha, int width, int height, uint8_t threshold, float scaleX, float scaleY);
+Hull RectHull(float width, float height);
+
+// angle is in degrees clockwise, as the sprites are drawn.
+void TransformHull(const Hull &hull, float cx, float cy, float angle, Polygon &out);
+
+// Separating axis test between a circle and a convex polygon.
+bool CircleOverlapsPolygon(float cx, float cy, float radius, const Polygon &polygon);
+
+// Sweeps a circle from (cx, cy) by (dx, dy) and reports the fraction of the
+// move at which it first touches polygon, 0 if it starts overlapping. Returns
+// false if it misses.
+bool SweepCircleAgainstPolygon(float cx, float cy, float radius, float dx, float dy, const Polygon &polygon, float &time);
+
+#endif
@@ -0,0 +1,86 @@
+#include "dirty_regions.h"
+#include <algorithm>
+#include <math.h>
+
+// Beyond this many rects per frame the per-rect copies cost more than
+// repainting everything.
+#define DIRTY_RECT_LIMIT 256
+
+DirtyRegions::DirtyRegions(int width, int height)
+{
+    mScreen = {0, 0, width, height};
+    mStale.reserve(DIRTY_RECT_LIMIT);
+    mCurrent.reserve(DIRTY_RECT_LIMIT);
+    mChanged.reserve(DIRTY_RECT_LIMIT * 2);
+    mStale.push_back(mScreen);
+    mFull = false;
+}
+
+void DirtyRegions::Add(const SDL_Rect &rect)
+{
+    if(mFull) return;
+
+    SDL_Rect clipped;
+    if(!SDL_IntersectRect(&rect, &mScreen, &clipped)) return;
+
+    if(!mCurrent.empty())
+    {
+        SDL_Rect &last = mCurrent.back();
+        if(clipped.x <= last.x + last.w && last.x <= clipped.x + clipped.w &&
+           clipped.y <= last.y + last.h && last.y <= clipped.y + clipped.h)
+        {
+            SDL_UnionRect(&last, &clipped, &last);
+            return;
+        }
+    }
+
+    if(mCurrent.size() == DIRTY_RECT_LIMIT)
+    {
+        mCurrent.clear();
+        mCurrent.push_back(mScreen);
+        mFull = true;
+        return;
+    }
+    mCurrent.push_back(clipped);
+}
+
+void DirtyRegions::AddQuad(const SDL_Vertex *vertices)
+{
+    float minX = vertices[0].position.x;
+    float minY = vertices[0].position.y;
+    float maxX = minX;
+    float maxY = minY;
+    for(int i=1; i < 4; i++)
+    {
+        minX = std::min(minX, vertices[i].position.x);
+        minY = std::min(minY, vertices[i].position.y);
+        maxX = std::max(maxX, vertices[i].position.x);
+        maxY = std::max(maxY, vertices[i].position.y);
+    }
+
+    // A pixel of margin for the rasteriser's rounding.
+    int x = (int)floorf(minX) - 1;
+    int y = (int)floorf(minY) - 1;
+    Add({x, y, (int)ceilf(maxX) + 1 - x, (int)ceilf(maxY) + 1 - y});
+}
+
+void DirtyRegions::Invalidate()
+{
+    mCurrent.clear();
+    mCurrent.push_back(mScreen);
+    mFull = true;
+}
+
+const std::vector<SDL_Rect> &DirtyRegions::Changed()
+{
+    mChanged.assign(mStale.begin(), mStale.end());
+    mChanged.insert(mChanged.end(), mCurrent.begin(), mCurrent.end());
+    return mChanged;
+}
+
+void DirtyRegions::Swap()
+{
+    std::swap(mStale, mCurrent);
+    mCurrent.clear();
+    mFull = false;
+}
@@ -0,0 +1,46 @@
+#ifndef DIRTY_REGIONS_H
+#define DIRTY_REGIONS_H
+
+#include <SDL2/SDL.h>
+#include <vector>
+
+// Screen rectangles drawn over the cached background in the current and the
+// previous frame. Restoring the previous frame's rects before drawing puts
+// the background back everywhere, so only those and the current frame's
+// rects have to be repainted and presented. The first frame restores the
+// whole screen.
+class DirtyRegions
+{
+    public:
+        DirtyRegions(int width, int height);
+
+        // Clipped to the screen. Touching the last rect merges with it, which
+        // keeps a line of glyphs to one rect. Past the rect limit the whole
+        // screen is dirty.
+        void Add(const SDL_Rect &rect);
+        // Bounds of a quad of four vertices.
+        void AddQuad(const SDL_Vertex *vertices);
+        // Repaint the whole screen next frame, after something else drew to it.
+        void Invalidate();
+
+        // The previous frame's rects, to restore before drawing this one.
+        const std::vector<SDL_Rect> &Stale() const
+        {
+            return mStale;
+        }
+
+        // The previous and current frames' rects, which together are what
+        // changed on screen.
+        const std::vector<SDL_Rect> &Changed();
+        // Start the next frame; the current rects become stale.
+        void Swap();
+
+    private:
+        SDL_Rect mScreen;
+        std::vector<SDL_Rect> mStale;
+        std::vector<SDL_Rect> mCurrent;
+        std::vector<SDL_Rect> mChanged;
+        bool mFull;
+};
+
+#endif
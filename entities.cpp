@@ -0,0 +1,254 @@
+#include "entities.h"
+#include <algorithm>
+
+template<typename T>
+static void swapAndPop(std::vector<T> &values, size_t i)
+{
+    values[i] = values.back();
+    values.pop_back();
+}
+
+template<typename T>
+static size_t memory(const std::vector<T> &values)
+{
+    return values.capacity() * sizeof(T);
+}
+
+EntityHandle HandleTable::Create(size_t index)
+{
+    uint32_t slot;
+    if(!mFreeSlots.empty())
+    {
+        slot = mFreeSlots.back();
+        mFreeSlots.pop_back();
+    }
+    else
+    {
+        slot = (uint32_t)mSlotToIndex.size();
+        mSlotToIndex.push_back(0);
+        mGenerations.push_back(0);
+    }
+    mSlotToIndex[slot] = (uint32_t)index;
+    if(mIndexToSlot.size() <= index)
+    {
+        mIndexToSlot.resize(index + 1);
+    }
+    mIndexToSlot[index] = slot;
+    return {slot, mGenerations[slot]};
+}
+
+void HandleTable::Remove(size_t index, size_t last)
+{
+    uint32_t slot = mIndexToSlot[index];
+    mGenerations[slot]++;
+    mFreeSlots.push_back(slot);
+
+    uint32_t moved = mIndexToSlot[last];
+    mIndexToSlot[index] = moved;
+    mSlotToIndex[moved] = (uint32_t)index;
+    mIndexToSlot.pop_back();
+}
+
+void HandleTable::Clear()
+{
+    for(uint32_t slot : mIndexToSlot)
+    {
+        mGenerations[slot]++;
+        mFreeSlots.push_back(slot);
+    }
+    mIndexToSlot.clear();
+}
+
+void HandleTable::Allocate(size_t capacity)
+{
+    mIndexToSlot.reserve(capacity);
+    mSlotToIndex.reserve(capacity);
+    mGenerations.reserve(capacity);
+    mFreeSlots.reserve(capacity);
+}
+
+size_t HandleTable::Memory() const
+{
+    return memory(mIndexToSlot) + memory(mSlotToIndex) + memory(mGenerations) + memory(mFreeSlots);
+}
+
+ptrdiff_t HandleTable::Lookup(EntityHandle handle) const
+{
+    if(handle.slot >= mGenerations.size() || mGenerations[handle.slot] != handle.generation)
+    {
+        return -1;
+    }
+    return mSlotToIndex[handle.slot];
+}
+
+EntityHandle Asteroids::Add(Vector2 pos, Vector2 velocity, float angle, float rotationSpeed, int width, int height, AsteroidType type)
+{
+    if(Full())
+    {
+        stats.refused++;
+        return INVALID_HANDLE;
+    }
+    x.push_back(pos.x);
+    y.push_back(pos.y);
+    prevX.push_back(pos.x);
+    prevY.push_back(pos.y);
+    prevAngle.push_back(angle);
+    vx.push_back(velocity.x);
+    vy.push_back(velocity.y);
+    this->angle.push_back(angle);
+    this->rotationSpeed.push_back(rotationSpeed);
+    this->width.push_back(width);
+    this->height.push_back(height);
+    this->type.push_back(type);
+    destroyed.push_back(0);
+    stats.peak = std::max(stats.peak, x.size());
+    return handles.Create(x.size() - 1);
+}
+
+void Asteroids::Remove(size_t i)
+{
+    handles.Remove(i, x.size() - 1);
+    swapAndPop(x, i);
+    swapAndPop(y, i);
+    swapAndPop(prevX, i);
+    swapAndPop(prevY, i);
+    swapAndPop(vx, i);
+    swapAndPop(vy, i);
+    swapAndPop(angle, i);
+    swapAndPop(prevAngle, i);
+    swapAndPop(rotationSpeed, i);
+    swapAndPop(width, i);
+    swapAndPop(height, i);
+    swapAndPop(type, i);
+    swapAndPop(destroyed, i);
+}
+
+void Asteroids::SavePrevious()
+{
+    prevX = x;
+    prevY = y;
+    prevAngle = angle;
+}
+
+void Asteroids::Clear()
+{
+    handles.Clear();
+    x.clear();
+    y.clear();
+    prevX.clear();
+    prevY.clear();
+    vx.clear();
+    vy.clear();
+    angle.clear();
+    prevAngle.clear();
+    rotationSpeed.clear();
+    width.clear();
+    height.clear();
+    type.clear();
+    destroyed.clear();
+}
+
+void Asteroids::Allocate(size_t capacity)
+{
+    stats.capacity = capacity;
+    handles.Allocate(capacity);
+    x.reserve(capacity);
+    y.reserve(capacity);
+    prevX.reserve(capacity);
+    prevY.reserve(capacity);
+    vx.reserve(capacity);
+    vy.reserve(capacity);
+    angle.reserve(capacity);
+    prevAngle.reserve(capacity);
+    rotationSpeed.reserve(capacity);
+    width.reserve(capacity);
+    height.reserve(capacity);
+    type.reserve(capacity);
+    destroyed.reserve(capacity);
+}
+
+size_t Asteroids::Memory() const
+{
+    return handles.Memory() + memory(x) + memory(y) + memory(prevX) + memory(prevY) + memory(prevAngle) +
+           memory(vx) + memory(vy) + memory(angle) + memory(rotationSpeed) + memory(width) + memory(height) +
+           memory(type) + memory(destroyed);
+}
+
+EntityHandle Bullets::Add(Vector2 pos, Vector2 velocity, float angle, int width, int height)
+{
+    if(Full())
+    {
+        stats.refused++;
+        return INVALID_HANDLE;
+    }
+    x.push_back(pos.x);
+    y.push_back(pos.y);
+    prevX.push_back(pos.x);
+    prevY.push_back(pos.y);
+    vx.push_back(velocity.x);
+    vy.push_back(velocity.y);
+    this->angle.push_back(angle);
+    this->width.push_back(width);
+    this->height.push_back(height);
+    destroyed.push_back(0);
+    stats.peak = std::max(stats.peak, x.size());
+    return handles.Create(x.size() - 1);
+}
+
+void Bullets::Remove(size_t i)
+{
+    handles.Remove(i, x.size() - 1);
+    swapAndPop(x, i);
+    swapAndPop(y, i);
+    swapAndPop(prevX, i);
+    swapAndPop(prevY, i);
+    swapAndPop(vx, i);
+    swapAndPop(vy, i);
+    swapAndPop(angle, i);
+    swapAndPop(width, i);
+    swapAndPop(height, i);
+    swapAndPop(destroyed, i);
+}
+
+void Bullets::SavePrevious()
+{
+    prevX = x;
+    prevY = y;
+}
+
+void Bullets::Clear()
+{
+    handles.Clear();
+    x.clear();
+    y.clear();
+    prevX.clear();
+    prevY.clear();
+    vx.clear();
+    vy.clear();
+    angle.clear();
+    width.clear();
+    height.clear();
+    destroyed.clear();
+}
+
+void Bullets::Allocate(size_t capacity)
+{
+    stats.capacity = capacity;
+    handles.Allocate(capacity);
+    x.reserve(capacity);
+    y.reserve(capacity);
+    prevX.reserve(capacity);
+    prevY.reserve(capacity);
+    vx.reserve(capacity);
+    vy.reserve(capacity);
+    angle.reserve(capacity);
+    width.reserve(capacity);
+    height.reserve(capacity);
+    destroyed.reserve(capacity);
+}
+
+size_t Bullets::Memory() const
+{
+    return handles.Memory() + memory(x) + memory(y) + memory(prevX) + memory(prevY) + memory(vx) + memory(vy) +
+           memory(angle) + memory(width) + memory(height) + memory(destroyed);
+}
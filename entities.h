@@ -0,0 +1,132 @@
+#ifndef ENTITIES_H
+#define ENTITIES_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include "game.h"
+
+// Refers to an entity independently of where it currently sits in the dense
+// arrays. A handle goes stale once its entity is removed.
+struct EntityHandle {
+    uint32_t slot;
+    uint32_t generation;
+};
+
+// Returned by Add when the pool is full; Lookup always reports it stale.
+#define INVALID_HANDLE EntityHandle{UINT32_MAX, 0}
+
+// Occupancy of a fixed-capacity pool. refused counts Adds dropped because
+// the pool was full.
+struct PoolStats {
+    size_t capacity;
+    size_t peak;
+    size_t refused;
+};
+
+// Maps stable handles to dense indices and keeps the mapping valid across
+// swap-and-pop removals.
+class HandleTable
+{
+    public:
+        EntityHandle Create(size_t index);
+        // The entity at index is removed and the last one moves into its place.
+        void Remove(size_t index, size_t last);
+        void Clear();
+        void Allocate(size_t capacity);
+        // Bytes of storage held.
+        size_t Memory() const;
+
+        // Dense index of handle, or -1 when it is stale.
+        ptrdiff_t Lookup(EntityHandle handle) const;
+
+    private:
+        std::vector<uint32_t> mIndexToSlot;
+        std::vector<uint32_t> mSlotToIndex;
+        std::vector<uint32_t> mGenerations;
+        std::vector<uint32_t> mFreeSlots;
+};
+
+// Asteroids stored as one array per field so updates, collision and drawing
+// walk memory linearly. Removal swaps the last asteroid into the hole, so
+// indices are only valid until the next Remove. The prev* arrays hold the
+// state at the start of the current tick for render interpolation. Storage
+// is a fixed-capacity pool sized by Allocate.
+struct Asteroids {
+    std::vector<float> x;
+    std::vector<float> y;
+    std::vector<float> prevX;
+    std::vector<float> prevY;
+    std::vector<float> prevAngle;
+    std::vector<float> vx;
+    std::vector<float> vy;
+    std::vector<float> angle;
+    std::vector<float> rotationSpeed;
+    std::vector<int> width;
+    std::vector<int> height;
+    std::vector<AsteroidType> type;
+    std::vector<uint8_t> destroyed;
+    HandleTable handles;
+    PoolStats stats = {0, 0, 0};
+
+    EntityHandle Add(Vector2 pos, Vector2 velocity, float angle, float rotationSpeed, int width, int height, AsteroidType type);
+    void Remove(size_t i);
+    void SavePrevious();
+    // Drops every entity at once; the storage stays allocated.
+    void Clear();
+    // Allocates storage for capacity entities once. Add refuses anything
+    // beyond it, so gameplay never grows the arrays.
+    void Allocate(size_t capacity);
+    // Bytes of storage held, handles included.
+    size_t Memory() const;
+
+    size_t Size() const
+    {
+        return x.size();
+    }
+
+    bool Full() const
+    {
+        return x.size() >= stats.capacity;
+    }
+};
+
+// Bullet velocity is fixed at spawn, so the direction is computed once
+// there instead of every tick.
+struct Bullets {
+    std::vector<float> x;
+    std::vector<float> y;
+    std::vector<float> prevX;
+    std::vector<float> prevY;
+    std::vector<float> vx;
+    std::vector<float> vy;
+    std::vector<float> angle;
+    std::vector<int> width;
+    std::vector<int> height;
+    std::vector<uint8_t> destroyed;
+    HandleTable handles;
+    PoolStats stats = {0, 0, 0};
+
+    EntityHandle Add(Vector2 pos, Vector2 velocity, float angle, int width, int height);
+    void Remove(size_t i);
+    void SavePrevious();
+    // Drops every entity at once; the storage stays allocated.
+    void Clear();
+    // Allocates storage for capacity entities once. Add refuses anything
+    // beyond it, so gameplay never grows the arrays.
+    void Allocate(size_t capacity);
+    // Bytes of storage held, handles included.
+    size_t Memory() const;
+
+    size_t Size() const
+    {
+        return x.size();
+    }
+
+    bool Full() const
+    {
+        return x.size() >= stats.capacity;
+    }
+};
+
+#endif
@@ -0,0 +1,30 @@
+#ifndef GAME_H
+#define GAME_H
+
+#define TICK_INTERVAL 30
+#define WIDTH 1024
+#define HEIGHT 768
+#define PI 3.14159265
+#define MAX_BIG_ASTEROIDS 23
+// Pool capacities. archetypes.h checks that every big asteroid's fragments
+// fit, and bullets are culled once they leave the screen.
+#define MAX_ASTEROIDS 128
+#define MAX_BULLETS 64
+#define BULLET_SPEED 15
+
+struct Vector2 {
+    float x;
+    float y;
+    Vector2() : x(0), y(0) {}
+    Vector2(float x, float y) : x(x), y(y) {}
+};
+
+// Indexes ASTEROID_ARCHETYPES in archetypes.h.
+enum AsteroidType {
+    BIG,
+    MEDIUM,
+    SMALL,
+    ASTEROID_TYPES,
+};
+
+#endif
@@ -0,0 +1,232 @@
+#include "integrate.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64)
+#define INTEGRATE_X86 1
+#include <immintrin.h>
+#endif
+
+typedef void (*AsteroidKernel)(float*, float*, float*, const float*, const float*, const float*, size_t, size_t, float, float);
+typedef void (*BulletKernel)(float*, float*, const float*, const float*, size_t, size_t);
+
+// Kernels process [begin, end) so the vector versions can hand their tail
+// to the scalar one.
+static void asteroidsScalar(float *x, float *y, float *angle, const float *vx, const float *vy,
+                            const float *rotation, size_t begin, size_t end,
+                            float width, float height)
+{
+    for(size_t i=begin; i < end; i++)
+    {
+        x[i] += vx[i];
+        y[i] += vy[i];
+        angle[i] += rotation[i];
+
+        if(angle[i] > 360) angle[i] -= 360;
+        else if(angle[i] < 360) angle[i] += 360;
+
+        if(x[i] < 0) x[i] += width;
+        else if(x[i] >= width) x[i] -= width;
+
+        if(y[i] < 0) y[i] += height;
+        else if(y[i] >= height) y[i] -= height;
+    }
+}
+
+static void bulletsScalar(float *x, float *y, const float *vx, const float *vy, size_t begin, size_t end)
+{
+    for(size_t i=begin; i < end; i++)
+    {
+        x[i] += vx[i];
+        y[i] += vy[i];
+    }
+}
+
+#ifdef INTEGRATE_X86
+
+// select(mask, a, b) without SSE4.1 blendv.
+static inline __m128 select128(__m128 mask, __m128 a, __m128 b)
+{
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+static inline __m128 wrap128(__m128 p, __m128 limit)
+{
+    __m128 below = _mm_cmplt_ps(p, _mm_setzero_ps());
+    __m128 above = _mm_cmpge_ps(p, limit);
+    return select128(below, _mm_add_ps(p, limit), select128(above, _mm_sub_ps(p, limit), p));
+}
+
+static void asteroidsSSE2(float *x, float *y, float *angle, const float *vx, const float *vy,
+                          const float *rotation, size_t begin, size_t end,
+                          float width, float height)
+{
+    const __m128 full = _mm_set1_ps(360.0f);
+    const __m128 limitX = _mm_set1_ps(width);
+    const __m128 limitY = _mm_set1_ps(height);
+    size_t i = begin;
+    for(; i + 4 <= end; i += 4)
+    {
+        __m128 px = _mm_add_ps(_mm_loadu_ps(x + i), _mm_loadu_ps(vx + i));
+        __m128 py = _mm_add_ps(_mm_loadu_ps(y + i), _mm_loadu_ps(vy + i));
+        __m128 a = _mm_add_ps(_mm_loadu_ps(angle + i), _mm_loadu_ps(rotation + i));
+
+        __m128 over = _mm_cmpgt_ps(a, full);
+        __m128 under = _mm_cmplt_ps(a, full);
+        a = select128(over, _mm_sub_ps(a, full), select128(under, _mm_add_ps(a, full), a));
+
+        _mm_storeu_ps(x + i, wrap128(px, limitX));
+        _mm_storeu_ps(y + i, wrap128(py, limitY));
+        _mm_storeu_ps(angle + i, a);
+    }
+    asteroidsScalar(x, y, angle, vx, vy, rotation, i, end, width, height);
+}
+
+static void bulletsSSE2(float *x, float *y, const float *vx, const float *vy, size_t begin, size_t end)
+{
+    size_t i = begin;
+    for(; i + 4 <= end; i += 4)
+    {
+        _mm_storeu_ps(x + i, _mm_add_ps(_mm_loadu_ps(x + i), _mm_loadu_ps(vx + i)));
+        _mm_storeu_ps(y + i, _mm_add_ps(_mm_loadu_ps(y + i), _mm_loadu_ps(vy + i)));
+    }
+    bulletsScalar(x, y, vx, vy, i, end);
+}
+
+__attribute__((target("avx2")))
+static inline __m256 wrap256(__m256 p, __m256 limit)
+{
+    __m256 below = _mm256_cmp_ps(p, _mm256_setzero_ps(), _CMP_LT_OQ);
+    __m256 above = _mm256_cmp_ps(p, limit, _CMP_GE_OQ);
+    return _mm256_blendv_ps(_mm256_blendv_ps(p, _mm256_sub_ps(p, limit), above), _mm256_add_ps(p, limit), below);
+}
+
+__attribute__((target("avx2")))
+static void asteroidsAVX2(float *x, float *y, float *angle, const float *vx, const float *vy,
+                          const float *rotation, size_t begin, size_t end,
+                          float width, float height)
+{
+    const __m256 full = _mm256_set1_ps(360.0f);
+    const __m256 limitX = _mm256_set1_ps(width);
+    const __m256 limitY = _mm256_set1_ps(height);
+    size_t i = begin;
+    for(; i + 8 <= end; i += 8)
+    {
+        __m256 px = _mm256_add_ps(_mm256_loadu_ps(x + i), _mm256_loadu_ps(vx + i));
+        __m256 py = _mm256_add_ps(_mm256_loadu_ps(y + i), _mm256_loadu_ps(vy + i));
+        __m256 a = _mm256_add_ps(_mm256_loadu_ps(angle + i), _mm256_loadu_ps(rotation + i));
+
+        __m256 over = _mm256_cmp_ps(a, full, _CMP_GT_OQ);
+        __m256 under = _mm256_cmp_ps(a, full, _CMP_LT_OQ);
+        a = _mm256_blendv_ps(_mm256_blendv_ps(a, _mm256_add_ps(a, full), under), _mm256_sub_ps(a, full), over);
+
+        _mm256_storeu_ps(x + i, wrap256(px, limitX));
+        _mm256_storeu_ps(y + i, wrap256(py, limitY));
+        _mm256_storeu_ps(angle + i, a);
+    }
+    asteroidsSSE2(x, y, angle, vx, vy, rotation, i, end, width, height);
+}
+
+__attribute__((target("avx2")))
+static void bulletsAVX2(float *x, float *y, const float *vx, const float *vy, size_t begin, size_t end)
+{
+    size_t i = begin;
+    for(; i + 8 <= end; i += 8)
+    {
+        _mm256_storeu_ps(x + i, _mm256_add_ps(_mm256_loadu_ps(x + i), _mm256_loadu_ps(vx + i)));
+        _mm256_storeu_ps(y + i, _mm256_add_ps(_mm256_loadu_ps(y + i), _mm256_loadu_ps(vy + i)));
+    }
+    bulletsSSE2(x, y, vx, vy, i, end);
+}
+
+#endif
+
+static bool sSelected = false;
+static IntegrateBackend sBackend = INTEGRATE_SCALAR;
+static AsteroidKernel sAsteroidKernel = asteroidsScalar;
+static BulletKernel sBulletKernel = bulletsScalar;
+
+static bool supported(IntegrateBackend backend)
+{
+    switch (backend)
+    {
+    case INTEGRATE_SCALAR:
+        return true;
+#ifdef INTEGRATE_X86
+    case INTEGRATE_SSE2:
+        return __builtin_cpu_supports("sse2");
+    case INTEGRATE_AVX2:
+        return __builtin_cpu_supports("avx2");
+#else
+    default:
+        return false;
+#endif
+    }
+    return false;
+}
+
+IntegrateBackend DetectIntegrateBackend()
+{
+    if(supported(INTEGRATE_AVX2)) return INTEGRATE_AVX2;
+    if(supported(INTEGRATE_SSE2)) return INTEGRATE_SSE2;
+    return INTEGRATE_SCALAR;
+}
+
+bool SetIntegrateBackend(IntegrateBackend backend)
+{
+    if(!supported(backend)) return false;
+    sSelected = true;
+    sBackend = backend;
+    switch (backend)
+    {
+    case INTEGRATE_SCALAR:
+        sAsteroidKernel = asteroidsScalar;
+        sBulletKernel = bulletsScalar;
+        break;
+#ifdef INTEGRATE_X86
+    case INTEGRATE_SSE2:
+        sAsteroidKernel = asteroidsSSE2;
+        sBulletKernel = bulletsSSE2;
+        break;
+    case INTEGRATE_AVX2:
+        sAsteroidKernel = asteroidsAVX2;
+        sBulletKernel = bulletsAVX2;
+        break;
+#else
+    default:
+        break;
+#endif
+    }
+    return true;
+}
+
+IntegrateBackend GetIntegrateBackend()
+{
+    if(!sSelected) SetIntegrateBackend(DetectIntegrateBackend());
+    return sBackend;
+}
+
+const char *IntegrateBackendName(IntegrateBackend backend)
+{
+    switch (backend)
+    {
+    case INTEGRATE_SCALAR:
+        return "scalar";
+    case INTEGRATE_SSE2:
+        return "sse2";
+    case INTEGRATE_AVX2:
+        return "avx2";
+    }
+    return "unknown";
+}
+
+void IntegrateAsteroids(float *x, float *y, float *angle, const float *vx, const float *vy,
+                        const float *rotation, size_t count, float width, float height)
+{
+    if(!sSelected) SetIntegrateBackend(DetectIntegrateBackend());
+    sAsteroidKernel(x, y, angle, vx, vy, rotation, 0, count, width, height);
+}
+
+void IntegrateBullets(float *x, float *y, const float *vx, const float *vy, size_t count)
+{
+    if(!sSelected) SetIntegrateBackend(DetectIntegrateBackend());
+    sBulletKernel(x, y, vx, vy, 0, count);
+}
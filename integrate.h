@@ -0,0 +1,31 @@
+#ifndef INTEGRATE_H
+#define INTEGRATE_H
+
+#include <stddef.h>
+
+// Batch kernels that advance every entity of a kind in one sweep over the
+// struct-of-arrays storage. All backends produce bit-identical results; the
+// fastest one the CPU supports is picked on first use.
+enum IntegrateBackend {
+    INTEGRATE_SCALAR,
+    INTEGRATE_SSE2,
+    INTEGRATE_AVX2,
+};
+
+IntegrateBackend DetectIntegrateBackend();
+// Returns false when the CPU cannot run backend; the current one is kept.
+bool SetIntegrateBackend(IntegrateBackend backend);
+IntegrateBackend GetIntegrateBackend();
+const char *IntegrateBackendName(IntegrateBackend backend);
+
+// pos += velocity, angle += rotation with the angle kept near [0, 720), and
+// the position wrapped into [0, width) x [0, height), the playfield torus.
+// Whatever hangs past the right or bottom edge shows as a ghost on the
+// opposite one; see wrap.h.
+void IntegrateAsteroids(float *x, float *y, float *angle, const float *vx, const float *vy,
+                        const float *rotation, size_t count, float width, float height);
+
+// pos += velocity. Bullets do not rotate or wrap.
+void IntegrateBullets(float *x, float *y, const float *vx, const float *vy, size_t count);
+
+#endif
@@ -0,0 +1,147 @@
+#include "jobs.h"
+#include <algorithm>
+
+JobSystem gJobs;
+
+static thread_local int sWorkerIndex = 0;
+
+JobQueue::JobQueue()
+{
+    mHead = 0;
+    mTail = 0;
+}
+
+bool JobQueue::Push(const Job &job)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    if(mTail - mHead >= JOB_QUEUE_CAPACITY) return false;
+    mJobs[mTail++ % JOB_QUEUE_CAPACITY] = job;
+    return true;
+}
+
+bool JobQueue::Pop(Job &job)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    if(mTail == mHead) return false;
+    job = mJobs[--mTail % JOB_QUEUE_CAPACITY];
+    return true;
+}
+
+bool JobQueue::Steal(Job &job)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    if(mTail == mHead) return false;
+    job = mJobs[mHead++ % JOB_QUEUE_CAPACITY];
+    return true;
+}
+
+JobSystem::JobSystem()
+{
+    mThreads = 1;
+    mQueues = nullptr;
+    mQueued = 0;
+    mRemaining = 0;
+    mRunning = false;
+}
+
+JobSystem::~JobSystem()
+{
+    Stop();
+}
+
+int JobSystem::WorkerIndex()
+{
+    return sWorkerIndex;
+}
+
+void JobSystem::Start(int threads)
+{
+    Stop();
+    mThreads = std::max(1, std::min(threads, MAX_JOB_THREADS));
+    if(mThreads == 1) return;
+
+    mQueues = new JobQueue[mThreads];
+    mRunning = true;
+    mWorkers.reserve(mThreads - 1);
+    for(int i=1; i < mThreads; i++)
+    {
+        mWorkers.emplace_back(&JobSystem::WorkerLoop, this, i);
+    }
+}
+
+void JobSystem::Stop()
+{
+    if(mQueues == nullptr) return;
+    {
+        std::lock_guard<std::mutex> lock(mSleepMutex);
+        mRunning = false;
+    }
+    mWake.notify_all();
+    for(auto &worker : mWorkers)
+    {
+        worker.join();
+    }
+    mWorkers.clear();
+    delete[] mQueues;
+    mQueues = nullptr;
+    mThreads = 1;
+}
+
+void JobSystem::Run(size_t count, size_t grain, void (*run)(void*, size_t, size_t), void *body)
+{
+    // A few chunks per thread so a stalled worker's share can be stolen.
+    size_t chunks = std::min<size_t>(mThreads * 4, JOB_QUEUE_CAPACITY);
+    size_t size = std::max(grain, (count + chunks - 1) / chunks);
+    chunks = (count + size - 1) / size;
+
+    // Dealt round-robin, so each worker starts on its own deque and only
+    // steals once that runs dry.
+    mRemaining = (int)chunks;
+    size_t chunk = 0;
+    for(size_t begin=0; begin < count; begin += size)
+    {
+        mQueues[chunk++ % mThreads].Push({run, body, begin, std::min(begin + size, count)});
+    }
+    {
+        std::lock_guard<std::mutex> lock(mSleepMutex);
+        mQueued += (int)chunks;
+    }
+    mWake.notify_all();
+
+    while(mRemaining.load(std::memory_order_acquire) > 0)
+    {
+        if(!RunOne(0))
+        {
+            std::this_thread::yield();
+        }
+    }
+}
+
+bool JobSystem::RunOne(int worker)
+{
+    Job job;
+    bool found = mQueues[worker].Pop(job);
+    for(int i=1; !found && i < mThreads; i++)
+    {
+        found = mQueues[(worker + i) % mThreads].Steal(job);
+    }
+    if(!found) return false;
+
+    mQueued--;
+    job.run(job.body, job.begin, job.end);
+    mRemaining.fetch_sub(1, std::memory_order_release);
+    return true;
+}
+
+void JobSystem::WorkerLoop(int worker)
+{
+    sWorkerIndex = worker;
+    while(true)
+    {
+        if(RunOne(worker)) continue;
+
+        std::unique_lock<std::mutex> lock(mSleepMutex);
+        mWake.wait(lock, [this] { return mQueued.load() > 0 || !mRunning; });
+        if(!mRunning) return;
+    }
+}
@@ -0,0 +1,97 @@
+#ifndef JOBS_H
+#define JOBS_H
+
+#include <stddef.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#define MAX_JOB_THREADS 64
+#define JOB_QUEUE_CAPACITY 1024
+
+// A range of a ParallelFor. The body lives on the caller's stack, so
+// submitting work never allocates.
+struct Job {
+    void (*run)(void *body, size_t begin, size_t end);
+    void *body;
+    size_t begin;
+    size_t end;
+};
+
+// Fixed-capacity deque. The owning thread pushes and pops at the back;
+// other threads steal from the front, so a thief takes the oldest and
+// usually largest remaining piece of work.
+class JobQueue
+{
+    public:
+        JobQueue();
+
+        bool Push(const Job &job);
+        bool Pop(Job &job);
+        bool Steal(Job &job);
+
+    private:
+        std::mutex mMutex;
+        Job mJobs[JOB_QUEUE_CAPACITY];
+        size_t mHead;
+        size_t mTail;
+};
+
+// Work-stealing thread pool. The calling thread is worker 0 and helps run
+// its own jobs, so Start(1) runs everything inline with no threads at all.
+// ParallelFor must not be nested and must only be called from worker 0.
+class JobSystem
+{
+    public:
+        JobSystem();
+        ~JobSystem();
+
+        void Start(int threads);
+        void Stop();
+
+        int Threads() const
+        {
+            return mThreads;
+        }
+
+        // Index of the calling worker, 0 for the thread that owns the pool.
+        static int WorkerIndex();
+
+        // Calls body(begin, end) over disjoint ranges covering [0, count),
+        // at least grain items each, and returns once all have finished.
+        // Small counts run inline on the caller.
+        template<typename F>
+        void ParallelFor(size_t count, size_t grain, F &&body)
+        {
+            if(mThreads <= 1 || count <= grain)
+            {
+                if(count > 0) body((size_t)0, count);
+                return;
+            }
+            Run(count, grain, [](void *context, size_t begin, size_t end) {
+                (*(typename std::remove_reference<F>::type*)context)(begin, end);
+            }, (void*)&body);
+        }
+
+    private:
+        void Run(size_t count, size_t grain, void (*run)(void*, size_t, size_t), void *body);
+        bool RunOne(int worker);
+        void WorkerLoop(int worker);
+
+        int mThreads;
+        std::vector<std::thread> mWorkers;
+        JobQueue *mQueues;
+
+        std::atomic<int> mQueued;
+        std::atomic<int> mRemaining;
+        std::atomic<bool> mRunning;
+        std::mutex mSleepMutex;
+        std::condition_variable mWake;
+};
+
+extern JobSystem gJobs;
+
+#endif
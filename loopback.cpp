@@ -0,0 +1,54 @@
+#include "loopback.h"
+
+static double unit(Rng &rng)
+{
+    return rng.Next() * (1.0 / 4294967296.0);
+}
+
+LoopbackTransport::LoopbackTransport()
+{
+    mCount = 0;
+    mLatency = 0.0;
+    mJitter = 0.0;
+    mLoss = 0.0;
+    mSent = 0;
+    mDropped = 0;
+}
+
+void LoopbackTransport::Configure(double latency, double jitter, double loss, uint64_t seed)
+{
+    mLatency = latency;
+    mJitter = jitter;
+    mLoss = loss;
+    mRng.Seed(seed);
+}
+
+void LoopbackTransport::Send(const NetPacket &packet, double now)
+{
+    mSent++;
+    if(unit(mRng) < mLoss || mCount == CAPACITY)
+    {
+        mDropped++;
+        return;
+    }
+    mFlights[mCount].due = now + mLatency + unit(mRng) * mJitter;
+    mFlights[mCount].packet = packet;
+    mCount++;
+}
+
+bool LoopbackTransport::Receive(NetPacket &packet, double now)
+{
+    int earliest = -1;
+    for(int i=0; i < mCount; i++)
+    {
+        if(mFlights[i].due <= now && (earliest < 0 || mFlights[i].due < mFlights[earliest].due))
+        {
+            earliest = i;
+        }
+    }
+    if(earliest < 0) return false;
+
+    packet = mFlights[earliest].packet;
+    mFlights[earliest] = mFlights[--mCount];
+    return true;
+}
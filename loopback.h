@@ -0,0 +1,75 @@
+#ifndef LOOPBACK_H
+#define LOOPBACK_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "rng.h"
+
+// Ticks of input one packet can carry, and the most ticks a rollback
+// session can rewind.
+#define ROLLBACK_WINDOW 16
+
+// Held buttons of one player for one tick, a bit per InputAction.
+typedef uint8_t InputBits;
+
+enum NetPacketType {
+    // inputs[0..count) are player's input for ticks tick onwards.
+    NET_INPUT,
+    // Every input of player before tick has arrived.
+    NET_ACK,
+};
+
+struct NetPacket {
+    uint8_t type;
+    uint8_t player;
+    uint8_t count;
+    uint32_t tick;
+    InputBits inputs[ROLLBACK_WINDOW];
+};
+
+// One direction of an in-process link that behaves like a bad network:
+// each packet is dropped with probability loss, or delivered latency plus
+// up to jitter milliseconds after it was sent, so packets can also arrive
+// out of order. Packets beyond the in-flight capacity are dropped too.
+// Times are milliseconds on any clock the caller keeps steady.
+class LoopbackTransport
+{
+    public:
+        LoopbackTransport();
+
+        void Configure(double latency, double jitter, double loss, uint64_t seed);
+        void Send(const NetPacket &packet, double now);
+        // The earliest packet due by now. False when none is.
+        bool Receive(NetPacket &packet, double now);
+
+        uint64_t Sent() const
+        {
+            return mSent;
+        }
+
+        uint64_t Dropped() const
+        {
+            return mDropped;
+        }
+
+    private:
+        static const int CAPACITY = 256;
+
+        struct InFlight {
+            double due;
+            NetPacket packet;
+        };
+
+        InFlight mFlights[CAPACITY];
+        int mCount;
+        double mLatency;
+        double mJitter;
+        double mLoss;
+        // Separate from gRng so the network never changes the simulation.
+        Rng mRng;
+
+        uint64_t mSent;
+        uint64_t mDropped;
+};
+
+#endif
@@ -2,876 +2,1260 @@
 #include <SDL2/SDL_image.h>
 #include <SDL2/SDL_ttf.h>
 #include <SDL2/SDL_mixer.h>
+#include <atomic>
 #include <chrono>
 #include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <algorithm>
+#include <thread>
 #include <vector>
 #include <random>
-
-#define TICK_INTERVAL 30
-#define WIDTH 1024
-#define HEIGHT 768
-#define PI 3.14159265
-#define MAX_BIG_ASTEROIDS 23
-
-static Uint32 next_time;
-
-Uint32 time_left(void)
-{
-    Uint32 now;
-
-    now = SDL_GetTicks();
-    if(next_time <= now)
-        return 0;
-    else
-        return next_time - now;
-}
-
-struct Vector2 {
-    float x;
-    float y;
-    Vector2() : x(0), y(0) {}
-    Vector2(float x, float y) : x(x), y(y) {}
+#include "texture_cache.h"
+#include "atlas.h"
+#include "text.h"
+#include "simulation.h"
+#include "integrate.h"
+#include "replay.h"
+#include "savestate.h"
+#include "jobs.h"
+#include "profiler.h"
+#include "profiler_overlay.h"
+#include "snapshot.h"
+#include "asset_loader.h"
+#include "audio.h"
+#include "dirty_regions.h"
+#include "particles.h"
+#include "rollback.h"
+#include <stddef.h>
+#include <string.h>
+
+#define SPRITE_ATLAS "assets/Spritesheet/sheet.xml"
+#define BACKGROUND_TEXTURE "assets/Backgrounds/black.png"
+#define FONT_PATH "assets/Bonus/kenvector_future.ttf"
+#define FONT_SIZE 16
+#define TUNING_PATH "tuning.cfg"
+
+// Sprites are drawn from the atlas; the loose PNGs are only loaded when a
+// name is missing from it.
+#define BULLET_SPRITE "laserBlue03.png"
+#define BULLET_TEXTURE "assets/PNG/laser.png"
+// A colour per player; the hulls all come from the first, since the shapes
+// match.
+const char *SHIP_SPRITES[MAX_SHIPS] = {"playerShip1_blue.png", "playerShip1_orange.png", "playerShip1_green.png", "playerShip1_red.png"};
+const char *SHIP_TEXTURES[MAX_SHIPS] = {"assets/PNG/playerShip1_blue.png", "assets/PNG/playerShip1_orange.png",
+                                        "assets/PNG/playerShip1_green.png", "assets/PNG/playerShip1_red.png"};
+
+// Keys for thrust, left, right and fire, in InputAction order, per player.
+// Escape restarts for everyone.
+const SDL_Keycode PLAYER_KEYS[MAX_SHIPS][INPUT_RESTART] = {
+    {SDLK_w, SDLK_a, SDLK_d, SDLK_SPACE},
+    {SDLK_UP, SDLK_LEFT, SDLK_RIGHT, SDLK_RCTRL},
+    {SDLK_i, SDLK_j, SDLK_l, SDLK_k},
+    {SDLK_KP_8, SDLK_KP_4, SDLK_KP_6, SDLK_KP_0},
 };
 
-enum AsteroidType {
-    BIG=10,
-    MEDIUM=50,
-    SMALL=100,
+// Longest real time a single frame may feed into the simulation, so a stall
+// (window drag, breakpoint) does not trigger a long burst of catch-up ticks.
+#define MAX_FRAME_TIME 250.0
+// Pixels at least this opaque count towards a sprite's collision hull.
+#define HULL_ALPHA_THRESHOLD 128
+// Asset decoding threads, and how long each loading screen frame may spend
+// uploading textures.
+#define ASSET_THREADS 2
+#define UPLOAD_BUDGET_MS 4.0
+// Frame rate the software renderer is paced to when the display doesn't
+// report one; it has no vsync to wait on.
+#define DEFAULT_REFRESH_RATE 60
+
+// Particles alive at once; past it new ones replace the oldest. The
+// texture is a soft dot of this many pixels across.
+#define PARTICLE_CAPACITY 65536
+#define PARTICLE_TEXTURE_SIZE 8
+
+// Input latency histogram buckets, one per millisecond; the last bucket
+// collects everything slower.
+#define LATENCY_BUCKETS 256
+
+enum RenderState {
+    RENDER_STARTING,
+    RENDER_READY,
+    RENDER_FAILED,
 };
 
-bool collide(SDL_Rect a, SDL_Rect b);
-void createNewAsteroids(Vector2 Pos, AsteroidType type);
-void startGame();
-void restartGame();
-void startWave();
-void clear();
-SDL_Texture *loadText(std::string text, SDL_Color color);
+bool keyInput(SDL_Keycode key, InputEvent &input);
+bool loadAssets(bool vsync);
+SDL_Texture *cacheBackground(Texture *tile);
+SDL_Texture *createParticleTexture();
+void showLoading(AssetLoader &loader);
+void present();
+void framePresented();
+void checkDirtyFrame(const Snapshot &snapshot, float alpha);
+Hull spriteHull(const Sprite *sprite, const AssetLoader &loader, float scale);
+void freeAssets();
+void renderLoop(bool vsync, int refreshRate);
+void drawAsteroids(const Snapshot &snapshot, float alpha);
+void drawBullets(const Snapshot &snapshot, float alpha);
+void drawShip(const Snapshot &snapshot, float alpha);
+void drawParticles();
+void updateParticles(float ms);
+void render(const Snapshot &snapshot, float alpha);
+void draw(const Snapshot &snapshot, float alpha, const std::vector<SDL_Rect> *stale);
+void updateHud(const Snapshot &snapshot);
+float interpolate(float previous, float current, float alpha, float span);
+float interpolateWrapped(float previous, float current, float alpha, float span);
+float interpolateAngle(float previous, float current, float alpha);
 
 SDL_Window *gWindow;
+
+// Owned by the render thread: the renderer and everything created from it.
 SDL_Renderer *gRenderer;
 TTF_Font *gFont;
+GlyphAtlas *gGlyphs;
+TextureCache *gTextures;
+Atlas *gAtlas;
+SpriteBatch *gSpriteBatch;
+
+const Sprite *gAsteroidSprites[ASTEROID_TYPES];
+const Sprite *gBulletSprite;
+const Sprite *gShipSprites[MAX_SHIPS];
+
+// This frame's interpolated transforms for the asteroids and the ships,
+// gathered before drawing so the ghosts of those crossing a seam come out
+// of one pass over them. Only grow, like the snapshot arrays.
+struct WrapTransforms {
+    std::vector<float> x;
+    std::vector<float> y;
+    std::vector<float> angle;
+    std::vector<int> width;
+    std::vector<int> height;
+    GhostList ghosts;
+
+    void Resize(size_t count)
+    {
+        if(x.size() >= count) return;
+        x.resize(count);
+        y.resize(count);
+        angle.resize(count);
+        width.resize(count);
+        height.resize(count);
+    }
+};
 
-class Asteroid {
-    public:
-        Asteroid(SDL_Renderer *renderer, Vector2 pos, AsteroidType type) {
-            mRenderer = renderer;
-            SDL_Surface *surface = nullptr;
-            mType = type;
-            switch (type)
-            {
-            case BIG:
-                surface = IMG_Load("assets/PNG/Meteors/meteorBrown_big1.png");
-                mRotationSpeed = rand() % 10 * 0.05f;
-                mVelocity = Vector2(rand()%10 * 0.1f,  rand()%10 * 0.1f);
-                break;
-            case MEDIUM:
-                surface = IMG_Load("assets/PNG/Meteors/meteorBrown_med1.png");
-                mRotationSpeed = rand() % 10 * 0.05f;
-                mVelocity = Vector2(rand()%10 * 0.3f,  rand()%10 * 0.3f);
-                break;
-            case SMALL:
-                surface = IMG_Load("assets/PNG/Meteors/meteorBrown_tiny1.png");
-                mRotationSpeed = rand() % 10 * 0.1f;
-                mVelocity = Vector2(rand()%10 * 0.5f,  rand()%10 * 0.5f);
-                break;
-            }
-            mTexture = SDL_CreateTextureFromSurface(renderer, surface);
-            SDL_QueryTexture(mTexture, nullptr, nullptr, &mWidth, &mHeight);
-            SDL_FreeSurface(surface);
+WrapTransforms gAsteroidTransforms;
+WrapTransforms gShipTransforms;
+
+// The background image tiled over the whole screen once at startup, so a
+// frame starts with a single copy, or with a copy of just the stale rects
+// in dirty rect mode.
+SDL_Texture *gBackground;
+Audio gAudio;
+ParticleSystem *gParticles;
+SDL_Texture *gParticleTexture;
+std::vector<SDL_Vertex> gParticleVertices;
+ProfilerOverlay *gSimOverlay;
+ProfilerOverlay *gRenderOverlay;
+TextLabel *gScoreLabel;
+TextLabel *gLivesLabel;
+TextLabel *gWaveLabel;
+TextLabel *gNewWaveLabel;
+TextLabel *gGameOverLabel;
+TextLabel *gGameStartLabel;
+TextLabel *gGameStartingLabel;
+TextLabel *gRestartLabel;
+SDL_Rect gScorePos = {WIDTH/2-8, 20, 16, 16};
+SDL_Rect gNewWavePos = {WIDTH/2 - 8*32/2, 200, 8*32, 32};
+SDL_Rect gLivesPos = {20, 20, 16, 16};
+SDL_Rect gWavePos = {WIDTH-20-16, 20, 16, 16};
+SDL_Rect gGameOverPos = {WIDTH/2 - 9*16/2, HEIGHT/2 - 8, 9*16, 16};
+SDL_Rect gGameStartPos = {WIDTH/2 - 10*32/2, 200, 10*32, 32};
+SDL_Rect gGameStartingPos = {WIDTH/2 - 21*32/2, 300, 21*32, 32};
+SDL_Rect gRestartPos = {WIDTH/2 - 23*32/2, 300, 23*32, 32};
 
-            mPos = pos;
-            mAngle = rand() % 360;
+// Dirty rect mode draws with the software renderer straight into the
+// window surface, which keeps its pixels between frames, and only repaints
+// and presents what changed. The check mode redraws every frame in full as
+// well and compares the pixels.
+bool gDirtyRects = false;
+bool gDirtyCheck = false;
+DirtyRegions gDirty(WIDTH, HEIGHT);
+std::vector<Uint32> gDirtyPixels;
+std::vector<Uint32> gFullPixels;
+Uint32 gDirtyChecked = 0;
+Uint32 gDirtyMismatches = 0;
+
+// Values currently laid out in the HUD labels, -1 forces a layout.
+int gHudLives = -1;
+int gHudScore = -1;
+int gHudWave = -1;
+
+// The render thread's phases, and a copy of the simulation thread's frame
+// totals as they arrive in snapshots for the overlay to draw.
+Profiler gRenderProfiler("render");
+Profiler gSimProfilerView("simulation");
+
+// Toggled with F3 on the simulation thread and passed on in snapshots.
+bool gShowProfiler = false;
+
+// The simulation thread publishes one snapshot per loop; the render thread
+// draws the newest one it has.
+TripleBuffer<Snapshot> gSnapshots;
+std::atomic<bool> gRunning(true);
+std::atomic<int> gRenderState(RENDER_STARTING);
+// Sounds the simulation emits, played by the render thread.
+SoundQueue gSounds;
+// Effects the simulation emits, turned into particles by the render thread.
+EffectQueue gEffects;
+// When main started, for the startup timings.
+Uint64 gStartupCounter;
+
+// Time from polling a key to SDL_RenderPresent returning on the first frame
+// that shows its effect. Scan-out adds up to one more refresh. Only touched
+// by the render thread.
+struct LatencyStats {
+    uint32_t histogram[LATENCY_BUCKETS];
+    uint32_t count;
+    double total;
+    double max;
+
+    void Add(double ms)
+    {
+        histogram[std::min((int)ms, LATENCY_BUCKETS - 1)]++;
+        count++;
+        total += ms;
+        max = std::max(max, ms);
+    }
 
-            mDestroyed = false;
+    // Upper bound of the bucket holding the p-th sample.
+    int Percentile(double p) const
+    {
+        uint32_t target = (uint32_t)(p * count);
+        uint32_t seen = 0;
+        for(int i=0; i < LATENCY_BUCKETS; i++)
+        {
+            seen += histogram[i];
+            if(seen > target) return i + 1;
         }
+        return LATENCY_BUCKETS;
+    }
+};
 
-        ~Asteroid() {
-            SDL_DestroyTexture(mTexture);
-            mRenderer = nullptr;
-        }
+LatencyStats gLatency = {};
 
-        SDL_Rect Rect()
+int main(int argc, char **argv)
+{
+    bool vsync = true;
+    uint64_t seed = std::random_device()();
+    const char *recordPath = nullptr;
+    const char *replayPath = nullptr;
+    int threads = 1;
+    const char *tracePath = nullptr;
+    const char *statePath = nullptr;
+    double latency = 0.0;
+    double jitter = 0.0;
+    double loss = 0.0;
+    const char *tuningPath = TUNING_PATH;
+    for(int i=1; i < argc; i++)
+    {
+        if(strcmp(argv[i], "--check-collisions") == 0)
         {
-            return {(int)mPos.x, (int)mPos.y, mWidth, mHeight};
+            gCheckCollisions = true;
         }
-
-        Vector2 Pos() const
+        else if(strcmp(argv[i], "--scalar") == 0)
         {
-            return mPos;
+            SetIntegrateBackend(INTEGRATE_SCALAR);
         }
-
-        void Draw() {
-            SDL_Rect dstrect = {(int)mPos.x, (int)mPos.y, mWidth, mHeight};
-            SDL_RenderCopyEx(mRenderer, mTexture, nullptr, &dstrect, mAngle-90, nullptr, SDL_FLIP_NONE);
-        }
-
-        void SetVelocity(Vector2 velocity) {
-            mVelocity = velocity;
-        }
-
-        void Update() {
-            mPos.x += mVelocity.x;
-            mPos.y += mVelocity.y;
-            mAngle += mRotationSpeed;
-
-            if(mAngle > 360) mAngle -= 360;
-            else if(mAngle < 360) mAngle += 360;
-
-            if(mPos.x < -mWidth)
-            {
-                mPos.x = WIDTH;
-            }
-            else if(mPos.x > WIDTH)
-            {
-                mPos.x = -mWidth;
-            }
-
-            if(mPos.y < -mHeight)
-            {
-                mPos.y = HEIGHT;
-            }
-            else if(mPos.y > HEIGHT)
-            {
-                mPos.y = -mHeight;
-            }
-        }
-
-        void Destroy()
+        else if(strcmp(argv[i], "--uncapped") == 0)
         {
-            mDestroyed = true;
+            vsync = false;
         }
-
-        bool Destroyed() const
+        else if(strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
         {
-            return mDestroyed;
+            threads = atoi(argv[++i]);
         }
-
-        AsteroidType Type() const
+        else if(strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
         {
-            return mType;
+            seed = strtoull(argv[++i], nullptr, 10);
         }
-
-    private:
-        SDL_Renderer *mRenderer;
-        SDL_Texture *mTexture;
-        Vector2 mPos;
-        Vector2 mVelocity;
-        float mRotationSpeed;
-        float mAngle;
-
-        int mWidth;
-        int mHeight;
-
-        bool mDestroyed;
-
-        AsteroidType mType;
-};
-
-class Bullet
-{
-    public:
-        Bullet(SDL_Renderer *renderer, Vector2 pos, float angle) {
-            mRenderer = renderer;
-            mSpeed = 15;
-            mAngle = angle;
-            mPos = pos;
-
-            mDestroyed = false;
-
-            SDL_Surface *surface = IMG_Load("assets/PNG/laser.png");
-            mTexture = SDL_CreateTextureFromSurface(renderer, surface);
-            SDL_QueryTexture(mTexture, nullptr, nullptr, &mWidth, &mHeight);
-            mWidth = mWidth/2;
-            mHeight = mHeight/2;
-            SDL_FreeSurface(surface);
-        }
-
-        ~Bullet() {
-            SDL_DestroyTexture(mTexture);
-            mRenderer = nullptr;
-        }
-
-        void Draw() {
-            SDL_Rect dstrect = {(int)mPos.x, (int)mPos.y, mWidth, mHeight};
-            // dstrect.x -= (dstrect.w / 2);
-	        // dstrect.y -= (dstrect.h / 2);
-            SDL_RenderCopyEx(mRenderer, mTexture, nullptr, &dstrect, mAngle-90, nullptr, SDL_FLIP_NONE);
+        else if(strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+        {
+            recordPath = argv[++i];
         }
-
-        void Update() {
-            Vector2 velocity = Vector2(-1 * cos(mAngle * PI / 180), -1 * sin(mAngle * PI / 180));
-            auto m = sqrt(velocity.x*velocity.x + velocity.y*velocity.y);
-            velocity.x /= m;
-            velocity.y /= m;
-
-            mPos.x += velocity.x * mSpeed;
-            mPos.y += velocity.y * mSpeed;
+        else if(strcmp(argv[i], "--replay") == 0 && i + 1 < argc)
+        {
+            replayPath = argv[++i];
         }
-
-        SDL_Rect Rect()
+        else if(strcmp(argv[i], "--profile") == 0)
         {
-            return {(int)mPos.x, (int)mPos.y, mWidth, mHeight};
+            gShowProfiler = true;
         }
-
-        bool Destroyed() const
+        else if(strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
         {
-            return mDestroyed;
+            tracePath = argv[++i];
         }
-
-        void Collide(std::vector<Asteroid*> &asteroids)
+        else if(strcmp(argv[i], "--stress") == 0 && i + 1 < argc)
         {
-            size_t i=0;
-            bool collided = false;
-            for(; i<asteroids.size(); i++)
-            {
-                if(!asteroids[i]->Destroyed() && collide(Rect(), asteroids[i]->Rect()))
-                {
-                    collided = true;
-                    break;
-                }
-            }
-            if(collided)
-            {
-                asteroids[i]->Destroy();
-                mDestroyed = true;
-            }
+            gStressAsteroids = strtoull(argv[++i], nullptr, 10);
         }
-
-    private:
-        SDL_Renderer *mRenderer;
-        Vector2 mPos;
-        SDL_Texture *mTexture;
-
-        float mSpeed;
-
-        int mWidth;
-        int mHeight;
-
-        float mAngle;
-        bool mDestroyed;
-};
-
-std::vector<Bullet*> gBullets;
-std::vector<Asteroid*> gAsteroids;
-
-SDL_Texture *gBackgroundTexture;
-SDL_Texture *gScoreTexture;
-SDL_Texture *gLivesTexture;
-SDL_Texture* gWaveTexture;
-SDL_Texture *gNewWaveTexture;
-SDL_Texture *gGameOverTexture;
-SDL_Texture *gGameStartTexture;
-SDL_Texture *gGameStartingTexture;
-SDL_Texture *gRestartTexture;
-SDL_Rect gScorePos = {WIDTH/2-8, 20, 16, 16};
-SDL_Rect gNewWavePos = {WIDTH/2 - 8*32/2, 200, 8*32, 32};
-SDL_Rect gLivesPos = {20, 20, 16, 16};
-SDL_Rect gWavePos = {WIDTH-20-16, 20, 16, 16};
-SDL_Rect gGameOverPos = {WIDTH/2 - 9*16/2, HEIGHT/2 - 8, 9*16, 16};
-SDL_Rect gGameStartPos = {WIDTH/2 - 10*32/2, 200, 10*32, 32};
-SDL_Rect gGameStartingPos = {WIDTH/2 - 21*32/2, 300, 21*32, 32};
-SDL_Rect gRestartPos = {WIDTH/2 - 23*32/2, 300, 23*32, 32};
-
-float gStartGameTime = 5000.0f;
-float gStartGameTimer = 0.0f;
-
-float gNewWaveTime = 3000.0f;
-float gNewWaveTimer = 0.0f;
-
-int gLives = 2;
-int gScore = 0;
-int gWave = 0;
-
-bool gIsGameStarted = false;
-bool gIsWaveEnd = true;
-bool gGameOver = false;
-
-class Ship
-{
-    public:
-        Ship(SDL_Renderer *renderer) {
-            mRenderer = renderer;
-            mIsMoving = false;
-            mSpeed = 16;
-            mRotationSpeed = 4;
-            mRotationDir = 0;
-            mAngle = 90;
-            mXPosDir = true;
-            mYPosDir = true;
-            mDestroyed = false;
-
-            mRespawnTime = 3000.0f;
-            mRespawnTimer = 0.0f;
-
-            mShootTime = 1000.0f;
-            mShootTimer = mShootTime;
-
-            SDL_Surface *surface = IMG_Load("assets/PNG/playerShip1_blue.png");
-            mTexture = SDL_CreateTextureFromSurface(renderer, surface);
-            SDL_QueryTexture(mTexture, nullptr, nullptr, &mWidth, &mHeight);
-            mWidth = mWidth/2;
-            mHeight = mHeight/2;
-            SDL_FreeSurface(surface);
-            mPos = Vector2(WIDTH/2-mWidth/2, HEIGHT/2-mHeight/2);
-            shootPos = Vector2(mWidth/2, 0);
-            mMaxVelocity = Vector2(mSpeed, mSpeed);
+        else if(strcmp(argv[i], "--stress-bullets") == 0 && i + 1 < argc)
+        {
+            gStressBullets = strtoull(argv[++i], nullptr, 10);
         }
-        ~Ship() {
-            SDL_DestroyTexture(mTexture);
-            mRenderer = nullptr;
+        else if(strcmp(argv[i], "--state") == 0 && i + 1 < argc)
+        {
+            statePath = argv[++i];
         }
-
-        SDL_Rect Rect()
+        else if(strcmp(argv[i], "--tuning") == 0 && i + 1 < argc)
         {
-            return {(int)mPos.x, (int)mPos.y, mWidth, mHeight};
+            tuningPath = argv[++i];
         }
-
-        void Destroy()
+        else if(strcmp(argv[i], "--players") == 0 && i + 1 < argc)
         {
-            mDestroyed = true;
+            gShipCount = atoi(argv[++i]);
         }
-
-        bool Destroyed()
+        else if(strcmp(argv[i], "--latency") == 0 && i + 1 < argc)
         {
-            return mDestroyed;
+            latency = atof(argv[++i]);
         }
-
-        void Respawn()
+        else if(strcmp(argv[i], "--jitter") == 0 && i + 1 < argc)
         {
-            if(mRespawnTimer >= mRespawnTime)
-            {
-                mDestroyed = false;
-                mPos = Vector2(WIDTH/2-mWidth/2, HEIGHT/2-mHeight/2);
-                mAngle = 90;
-                mIsMoving = false;
-                mXPosDir = true;
-                mYPosDir = true;
-                mRotationDir = 0;
-                mRespawnTimer = 0.0f;
-                mVelocity = Vector2(0, 0);
-                gLives--;
-            }
-            else
-            {
-                mRespawnTimer += TICK_INTERVAL;
-            }
+            jitter = atof(argv[++i]);
         }
-
-        void Draw() {
-            if(Destroyed()) return;
-            SDL_Rect dstrect = {(int)mPos.x, (int)mPos.y, mWidth, mHeight};
-            SDL_RenderCopyEx(mRenderer, mTexture, nullptr, &dstrect, mAngle-90, nullptr, SDL_FLIP_NONE);
+        else if(strcmp(argv[i], "--loss") == 0 && i + 1 < argc)
+        {
+            loss = atof(argv[++i]);
         }
-
-        void Input(SDL_Event event)
+        else if(strcmp(argv[i], "--dirty-rects") == 0)
         {
-            if(Destroyed()) return;
-            if(event.type == SDL_KEYDOWN)
-            {
-                switch (event.key.keysym.sym)
-                {
-                case SDLK_w:
-                    mIsMoving = true;
-                    break;
-                case SDLK_a:
-                    mRotationDir = -mRotationSpeed;
-                    break;
-                case SDLK_d:
-                    mRotationDir = mRotationSpeed;
-                    break;
-                case SDLK_SPACE:
-                    Shoot();
-                    break;
-                }
-            }
-            if(event.type == SDL_KEYUP)
-            {
-                switch (event.key.keysym.sym)
-                {
-                case SDLK_w:
-                    mIsMoving = false;
-                    break;
-                case SDLK_a:
-                    mRotationDir = 0;
-                    break;
-                case SDLK_d:
-                    mRotationDir = 0;
-                    break;
-                }
-            }
+            gDirtyRects = true;
         }
-
-        void Update()
+        else if(strcmp(argv[i], "--dirty-check") == 0)
         {
-            if(Destroyed()) return;
-            if(mIsMoving)
-            {
-                mVelocity = Vector2(-1 * cos(mAngle * PI / 180), -1 * sin(mAngle * PI / 180));
-                auto m = sqrt(mVelocity.x*mVelocity.x + mVelocity.y*mVelocity.y);
-                mVelocity.x /= m;
-                mVelocity.y /= m;
-
-                mVelocity.x *= mSpeed * 0.25;
-                mVelocity.y *= mSpeed * 0.25;
-
-                if(mVelocity.x > mMaxVelocity.x)
-                    mVelocity.x = mMaxVelocity.x;
-                
-                if(mVelocity.y > mMaxVelocity.y)
-                    mVelocity.y = mMaxVelocity.y;
-
-                if(mVelocity.x > 0) mXPosDir = true;
-                else mXPosDir = false;
-
-                if(mVelocity.y > 0) mYPosDir = true;
-                else mYPosDir = false;
-            }
-            else
-            {
-                if(mXPosDir && mVelocity.x > 0) mVelocity.x -= 0.25; 
-                else if(mVelocity.x < 0) mVelocity.x += 0.25;
-                else mVelocity.x = 0;
-
-                if(mYPosDir && mVelocity.y > 0) mVelocity.y -= 0.25;
-                else if(mVelocity.y < 0) mVelocity.y += 0.25;
-                else mVelocity.y = 0;
-            }
-
-            mPos.x += mVelocity.x;
-            mPos.y += mVelocity.y;
-            if(mRotationDir) mAngle += mRotationDir;
-            if(mAngle > 360) mAngle -= 360;
-            else if(mAngle < 360) mAngle += 360;
-
-            if(mPos.x < -mWidth)
-            {
-                mPos.x = WIDTH;
-            }
-            else if(mPos.x > WIDTH)
-            {
-                mPos.x = -mWidth;
-            }
-
-            if(mPos.y < -mHeight)
-            {
-                mPos.y = HEIGHT;
-            }
-            else if(mPos.y > HEIGHT)
-            {
-                mPos.y = -mHeight;
-            }
-
-            if(mShootTimer < mShootTime)
-            {
-                mShootTimer += TICK_INTERVAL;
-            }
+            gDirtyRects = true;
+            gDirtyCheck = true;
         }
+    }
+    // With --trace the profiler runs for the whole session, so the dump
+    // holds the last PROFILE_FRAMES frames even if the overlay never opened.
+    gProfiler.SetEnabled(gShowProfiler || tracePath != nullptr);
+
+    // Replays hold player 0's input only, so they are single player.
+    gShipCount = std::max(1, std::min(gShipCount, MAX_SHIPS));
+    bool multiplayer = gShipCount > 1;
+    if(multiplayer && (recordPath != nullptr || replayPath != nullptr))
+    {
+        SDL_Log("Recording and replaying are single player only\n");
+        recordPath = nullptr;
+        replayPath = nullptr;
+    }
 
-        void Shoot() {
-            if(mShootTimer >= mShootTime)
-            {
-                Vector2 bulletPos = Vector2(-cos(mAngle * PI / 180), -sin(mAngle * PI / 180));
-                auto m = sqrt(bulletPos.x*bulletPos.x + bulletPos.y*bulletPos.y);
-                bulletPos.x /= m;
-                bulletPos.y /= m;
-
-                // bulletPos = Vector2((mPos.x + 45) + mWidth / 2 * bulletPos.x, mPos.y + mHeight / 2 * bulletPos.y);
-
-                bulletPos = Vector2(mPos.x + shootPos.x, mPos.y + shootPos.y);
-
-                Bullet *bullet = new Bullet(mRenderer, bulletPos, mAngle);
-                gBullets.push_back(bullet);
-                mShootTimer = 0.0f;
-            }
+    // A recording stores the tuning it was played with and a replay
+    // restores it, whatever the file says now.
+    if(LoadTuning(tuningPath, gTuning)) SDL_Log("Tuning from %s\n", tuningPath);
+    ReplayRecorder recorder;
+    ReplayPlayer player;
+    if(replayPath != nullptr)
+    {
+        // Open has said why; playing live instead would look like a replay.
+        if(!player.Open(replayPath))
+        {
+            SDL_Log("Unable to replay %s\n", replayPath);
+            return 1;
         }
+        seed = player.Seed();
+        gTuning = player.GetTuning();
+        gPlayer = &player;
+    }
+    else if(recordPath != nullptr && recorder.Open(recordPath, seed, gTuning))
+    {
+        gRecorder = &recorder;
+    }
+    gRng.Seed(seed);
+    SDL_Log("Seed %llu\n", (unsigned long long)seed);
 
-    private:
-        SDL_Texture *mTexture;
-        SDL_Renderer *mRenderer;
-
-        Vector2 mPos;
-        Vector2 shootPos;
-        Vector2 mVelocity;
-        Vector2 mMaxVelocity;
-        bool mIsMoving;
-        float mSpeed;
-        float mRotationSpeed;
-        float mRotationDir;
-        int mWidth;
-        int mHeight;
-        float mAngle;
-
-        float mRespawnTime;
-        float mRespawnTimer;
-
-        float mShootTime;
-        float mShootTimer;
-
-        bool mXPosDir;
-        bool mYPosDir;
-        bool mDestroyed;
-};
-
-
-Ship *gShip = nullptr;
-
-int main(int, char**)
-{
+    gStartupCounter = SDL_GetPerformanceCounter();
     SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO);
     TTF_Init();
 
+    // The window and the event pump stay on the main thread, which also
+    // runs the simulation. The render thread creates the renderer and loads
+    // every asset behind a loading screen; the entity sizes come from the
+    // sprites, so the simulation waits for it to finish. Events are pumped
+    // meanwhile so the window stays responsive; they are handled once the
+    // game loop starts.
     gWindow = SDL_CreateWindow("Asteroids", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, WIDTH, HEIGHT, SDL_WINDOW_SHOWN);
-    gRenderer = SDL_CreateRenderer(gWindow, -1, SDL_RENDERER_ACCELERATED);
-    gFont = TTF_OpenFont("assets/Bonus/kenvector_future.ttf", 16);
+    SDL_DisplayMode mode;
+    int refreshRate = SDL_GetWindowDisplayMode(gWindow, &mode) == 0 && mode.refresh_rate > 0 ? mode.refresh_rate : DEFAULT_REFRESH_RATE;
+    std::thread renderThread(renderLoop, vsync, refreshRate);
+    while(gRenderState.load(std::memory_order_acquire) == RENDER_STARTING)
+    {
+        SDL_PumpEvents();
+        SDL_Delay(1);
+    }
+    if(gRenderState.load() == RENDER_FAILED)
+    {
+        renderThread.join();
+        SDL_DestroyWindow(gWindow);
+        return 1;
+    }
 
-    SDL_Surface *surface = IMG_Load("assets/Backgrounds/black.png");
-    gBackgroundTexture = SDL_CreateTextureFromSurface(gRenderer, surface);
-    SDL_FreeSurface(surface);
+    SDL_Log("Integration backend: %s\n", IntegrateBackendName(GetIntegrateBackend()));
+    gJobs.Start(threads);
+    SDL_Log("Simulation threads: %d\n", gJobs.Threads());
+
+    initSimulation();
+    gSoundQueue = &gSounds;
+    gEffectQueue = &gEffects;
+    for(int i=0; i < 3; i++)
+    {
+        gSnapshots.Slots()[i].Allocate(gAsteroids.stats.capacity, gBullets.stats.capacity);
+    }
+
+    // F5 captures the game between ticks and F9 puts it back, for quick
+    // retries. With --state FILE captures are also written to FILE, and a
+    // state already there is where the game starts.
+    SaveState saveState;
+    saveState.Reserve();
+    if(statePath != nullptr && replayPath == nullptr && recordPath == nullptr && !multiplayer && saveState.Read(statePath))
+    {
+        if(saveState.Restore()) SDL_Log("Restored %s at tick %u\n", statePath, gTick);
+        else SDL_Log("Save state %s does not fit this build\n", statePath);
+    }
+
+    // With --players N, player 0 plays locally and the others stand in
+    // for remote peers: their keys go through a loopback link with the
+    // given latency, jitter and loss, and the session predicts them until
+    // their input arrives, rewinding when it guessed wrong.
+    LoopbackTransport toSession;
+    LoopbackTransport toPeer;
+    toSession.Configure(latency, jitter, loss, seed);
+    toPeer.Configure(latency, jitter, loss, seed + 1);
+    RollbackSession session;
+    InputSender peer;
+    InputBits held[MAX_SHIPS] = {};
+    Uint64 sessionStart = SDL_GetPerformanceCounter();
+    if(multiplayer)
+    {
+        session.Start(1, &toSession, &toPeer);
+        peer.Start(((1u << gShipCount) - 1) & ~1u, gTick);
+        SDL_Log("Players: %d, latency %.0f ms, jitter %.0f ms, loss %.0f%%\n", gShipCount, latency, jitter, loss * 100.0);
+    }
 
-    gNewWaveTexture = loadText("New Wave", {255, 255, 255, 255});
-    gGameOverTexture = loadText("Game Over", {255, 255, 255, 255});
-    gGameStartTexture = loadText("Start Game", {255, 255, 255, 255});
-    gGameStartingTexture = loadText("Press space to start", {255, 255, 255, 255});
-    gRestartTexture = loadText("Press Escape to restart", {255, 255, 255, 255});
-    gShip = new Ship(gRenderer);
+    // Saving the tuning file applies it between two ticks. A replay or a
+    // rollback session assumes the values never change, so they keep the
+    // ones they started with.
+    TuningWatcher tuningWatcher;
+    bool liveTuning = !multiplayer && gRecorder == nullptr && gPlayer == nullptr;
+    if(liveTuning && !tuningWatcher.Start(tuningPath)) SDL_Log("Unable to watch %s\n", tuningPath);
 
     bool running = true;
     SDL_Event event;
 
+    // Simulation advances in fixed TICK_INTERVAL steps fed by real elapsed
+    // time and publishes a snapshot after each pass; the render thread
+    // blends the snapshot's last two ticks at its own pace.
+    Uint64 frequency = SDL_GetPerformanceFrequency();
+    Uint64 previous = SDL_GetPerformanceCounter();
+    double accumulator = 0.0;
+    Uint64 pendingInputTime = 0;
+    Uint64 appliedInputTime = 0;
+
     while(running)
     {
-        next_time = SDL_GetTicks() + TICK_INTERVAL;
-        while(SDL_PollEvent(&event))
+        Uint64 now = SDL_GetPerformanceCounter();
+        double elapsed = (now - previous) * 1000.0 / frequency;
+        previous = now;
+        accumulator += std::min(elapsed, MAX_FRAME_TIME);
+
+        gProfiler.BeginFrame();
         {
-            if(event.type == SDL_QUIT)
+            PROFILE_SCOPE(PHASE_EVENTS);
+            while(SDL_PollEvent(&event))
             {
-                running = false;
-            }
-            if(!gIsGameStarted)
-            {
-                if(event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_SPACE) {
-                    startGame();
+                if(event.type == SDL_QUIT)
+                {
+                    running = false;
                 }
-            }
-            else if(gGameOver)
-            {
-                if(event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_ESCAPE)
+                if(event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_F3)
                 {
-                    restartGame();
+                    gShowProfiler = !gShowProfiler;
+                    if(gShowProfiler) gProfiler.SetEnabled(true);
+                    else if(tracePath == nullptr) gProfiler.SetEnabled(false);
+                    continue;
                 }
-            }
-            else
-            {
-                if(!gShip->Destroyed()) {
-                    gShip->Input(event);
+                if(event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_F5)
+                {
+                    saveState.Capture();
+                    if(statePath != nullptr) saveState.Write(statePath);
+                    SDL_Log("Saved state at tick %u, %zu bytes\n", gTick, saveState.Bytes());
+                    continue;
+                }
+                if(event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_F9)
+                {
+                    // A replay only holds input, so a jump would desync it.
+                    if(gRecorder != nullptr || gPlayer != nullptr) SDL_Log("Save states are off while recording or replaying\n");
+                    // The session's saved ticks would no longer lead here.
+                    else if(multiplayer) SDL_Log("Save states are off in multiplayer\n");
+                    else if(saveState.Restore()) SDL_Log("Restored state at tick %u\n", gTick);
+                    continue;
+                }
+                if(event.type == SDL_KEYDOWN || event.type == SDL_KEYUP)
+                {
+                    InputEvent input;
+                    input.pressed = event.type == SDL_KEYDOWN;
+                    if(!keyInput(event.key.keysym.sym, input)) continue;
+                    if(multiplayer)
+                    {
+                        if(input.pressed) held[input.player] |= 1 << input.action;
+                        else held[input.player] &= ~(1 << input.action);
+                    }
+                    else
+                    {
+                        queueInput(input);
+                    }
+                    if(pendingInputTime == 0) pendingInputTime = SDL_GetPerformanceCounter();
                 }
             }
         }
-        
-        if(gIsGameStarted && gIsWaveEnd)
-        {
-            startWave();
-        }
 
-        for(auto &bullet : gBullets)
+        if(liveTuning && tuningWatcher.Changed())
         {
-            bullet->Update();
+            if(LoadTuning(tuningPath, gTuning)) SDL_Log("Reloaded %s at tick %u\n", tuningPath, gTick);
+            else SDL_Log("Kept the previous tuning\n");
         }
-        for(auto &asteroid: gAsteroids)
-        {
-            asteroid->Update();
-        }
-        gShip->Update();
 
-        if(!gShip->Destroyed())
+        while(accumulator >= TICK_INTERVAL)
         {
-            for(auto &asteroid : gAsteroids)
+            if(multiplayer)
             {
-                if(collide(gShip->Rect(), asteroid->Rect()))
+                double ms = (SDL_GetPerformanceCounter() - gStartupCounter) * 1000.0 / frequency;
+                peer.Record(gTick, held);
+                peer.Flush(&toSession, &toPeer, ms);
+                if(!session.Advance(held, ms))
                 {
-                    gShip->Destroy();
-                    asteroid->Destroy();
+                    // Waiting on remote input; keep polling for it without
+                    // piling up ticks to catch up on.
+                    accumulator = std::min(accumulator, (double)TICK_INTERVAL);
+                    SDL_Delay(1);
+                    break;
                 }
             }
-        }
-
-        if(gShip->Destroyed())
-        {
-            if(gLives <= 0)
+            else
             {
-                gGameOver = true;
+                tick();
             }
-            else
+            accumulator -= TICK_INTERVAL;
+            if(pendingInputTime != 0)
+            {
+                appliedInputTime = pendingInputTime;
+                pendingInputTime = 0;
+            }
+            if(gPlayer != nullptr && gPlayer->Finished(gTick))
             {
-                gShip->Respawn();
+                // Hand control back to the keyboard once the recording ends.
+                SDL_Log("Replay finished at tick %u%s\n", gTick, gDesyncTick != NO_DESYNC ? ", desynced" : "");
+                gPlayer = nullptr;
             }
         }
+        gProfiler.EndFrame();
+
+        Snapshot &snapshot = gSnapshots.Back();
+        snapshot.Capture();
+        snapshot.tickTime = SDL_GetPerformanceCounter() - (Uint64)(accumulator * frequency / 1000.0);
+        snapshot.inputTime = appliedInputTime;
+        snapshot.profiling = gProfiler.Enabled();
+        snapshot.showProfiler = gShowProfiler;
+        snapshot.simFrameStart = 0.0;
+        if(gProfiler.FrameCount() > 0)
+        {
+            const ProfileFrame &frame = gProfiler.Frame(0);
+            snapshot.simFrameStart = frame.start;
+            snapshot.simFrameDuration = frame.duration;
+            memcpy(snapshot.simPhases, frame.phases, sizeof(snapshot.simPhases));
+        }
+        gSnapshots.Publish();
 
-        for(auto &bullet : gBullets)
+        // Nothing changes until the next tick is due, so sleep until then
+        // instead of spinning; the renderer keeps interpolating meanwhile.
+        double wait = TICK_INTERVAL - accumulator;
+        if(wait >= 1.0)
         {
-            bullet->Collide(gAsteroids);
+            SDL_Delay((Uint32)wait);
         }
+    }
 
-        for(auto i=0; i < gBullets.size(); i++)
+    gRunning = false;
+    renderThread.join();
+
+    if(tracePath != nullptr)
+    {
+        const Profiler *profilers[] = {&gProfiler, &gRenderProfiler};
+        if(Profiler::WriteChromeTrace(tracePath, profilers, 2))
         {
-            if(gBullets[i]->Destroyed())
-            {
-                delete gBullets[i];
-                gBullets[i] = nullptr;
-            }
+            SDL_Log("Wrote trace to %s\n", tracePath);
         }
+    }
+
+    if(gLatency.count > 0)
+    {
+        SDL_Log("Input latency: %u samples, avg %.1f ms, p50 <%d ms, p99 <%d ms, max %.1f ms\n", gLatency.count,
+                gLatency.total / gLatency.count, gLatency.Percentile(0.50), gLatency.Percentile(0.99), gLatency.max);
+    }
+    SDL_Log("Asteroid pool: peak %zu of %zu, %zu refused\n", gAsteroids.stats.peak, gAsteroids.stats.capacity, gAsteroids.stats.refused);
+    SDL_Log("Bullet pool: peak %zu of %zu, %zu refused\n", gBullets.stats.peak, gBullets.stats.capacity, gBullets.stats.refused);
+    if(multiplayer)
+    {
+        const RollbackStats &stats = session.Stats();
+        double seconds = (double)(SDL_GetPerformanceCounter() - sessionStart) / frequency;
+        SDL_Log("Rollback: %llu ticks, %llu rollbacks, %.1f ticks resimulated/s, deepest %u, %llu stalls\n",
+                (unsigned long long)stats.ticks, (unsigned long long)stats.rollbacks, seconds > 0 ? stats.resimulated / seconds : 0.0,
+                stats.deepest, (unsigned long long)stats.stalls);
+        SDL_Log("Rollback CPU: %.2f%% resimulating, %.2f%% simulating; %llu packets sent, %llu dropped\n",
+                seconds > 0 ? stats.resimulateSeconds * 100.0 / seconds : 0.0, seconds > 0 ? stats.simulateSeconds * 100.0 / seconds : 0.0,
+                (unsigned long long)(toSession.Sent() + toPeer.Sent()), (unsigned long long)(toSession.Dropped() + toPeer.Dropped()));
+    }
+    recorder.Close(gTick);
+    gRecorder = nullptr;
+    gPlayer = nullptr;
+    gSoundQueue = nullptr;
+    gEffectQueue = nullptr;
+    clear();
+    gJobs.Stop();
+
+    SDL_DestroyWindow(gWindow);
 
-        gBullets.erase(std::remove_if(gBullets.begin(), gBullets.end(), [](const Bullet *bullet) { return bullet == nullptr; }), gBullets.end());
+    return 0;
+}
 
-        for(auto &asteroid: gAsteroids)
+// The player and action key is bound to, among the players in the game.
+bool keyInput(SDL_Keycode key, InputEvent &input)
+{
+    input.player = 0;
+    if(key == SDLK_ESCAPE)
+    {
+        input.action = INPUT_RESTART;
+        return true;
+    }
+    for(int p=0; p < gShipCount; p++)
+    {
+        for(int action=0; action < INPUT_RESTART; action++)
         {
-            if(asteroid->Destroyed())
+            if(PLAYER_KEYS[p][action] == key)
             {
-                gScore += (int)asteroid->Type();
-                switch (asteroid->Type())
-                {
-                    case BIG:
-                        createNewAsteroids(asteroid->Pos(), MEDIUM);
-                        break;
-                    case MEDIUM:
-                        createNewAsteroids(asteroid->Pos(), SMALL);
-                        break;
-                    case SMALL:
-                        break;
-                }
+                input.player = (uint8_t)p;
+                input.action = (uint8_t)action;
+                return true;
             }
         }
+    }
+    return false;
+}
+
+bool loadAssets(bool vsync)
+{
+    if(gDirtyRects)
+    {
+        SDL_Surface *surface = SDL_GetWindowSurface(gWindow);
+        gRenderer = surface ? SDL_CreateSoftwareRenderer(surface) : nullptr;
+    }
+    else
+    {
+        gRenderer = SDL_CreateRenderer(gWindow, -1, SDL_RENDERER_ACCELERATED | (vsync ? SDL_RENDERER_PRESENTVSYNC : 0));
+    }
+    if(gRenderer == nullptr)
+    {
+        SDL_Log("Unable to create renderer: %s\n", SDL_GetError());
+        return false;
+    }
+    gTextures = new TextureCache(gRenderer);
+    gAtlas = new Atlas(gTextures);
+
+    // Every image and the font are decoded on the loader's threads while
+    // this one shows the loading screen. Loose PNGs are only needed for
+    // sprites missing from the atlas.
+    AssetLoader loader(ASSET_THREADS);
+    bool atlas = gAtlas->Parse(SPRITE_ATLAS);
+    if(atlas) loader.Image(gAtlas->ImagePath());
+    for(const AsteroidArchetype &archetype : ASTEROID_ARCHETYPES)
+    {
+        if(!atlas || !gAtlas->Has(archetype.sprite)) loader.Image(archetype.texture);
+    }
+    if(!atlas || !gAtlas->Has(BULLET_SPRITE)) loader.Image(BULLET_TEXTURE);
+    for(int p=0; p < MAX_SHIPS; p++)
+    {
+        if(!atlas || !gAtlas->Has(SHIP_SPRITES[p])) loader.Image(SHIP_TEXTURES[p]);
+    }
+    loader.Image(BACKGROUND_TEXTURE);
+    loader.Font(FONT_PATH, FONT_SIZE);
+    // Without a device the game runs silent.
+    gAudio.Open();
+    gAudio.Load(loader);
+    showLoading(loader);
+    gAudio.Take(loader);
+
+    // From here on every texture is a cache hit.
+    if(atlas) gAtlas->Bind();
+    for(int t=0; t < ASTEROID_TYPES; t++)
+    {
+        gAsteroidSprites[t] = gAtlas->Find(ASTEROID_ARCHETYPES[t].sprite, ASTEROID_ARCHETYPES[t].texture);
+        gAsteroidSizes[t] = {gAsteroidSprites[t]->src.w, gAsteroidSprites[t]->src.h};
+        gAsteroidHulls[t] = spriteHull(gAsteroidSprites[t], loader, 1.0f);
+    }
+    gBulletSprite = gAtlas->Find(BULLET_SPRITE, BULLET_TEXTURE);
+    for(int p=0; p < MAX_SHIPS; p++)
+    {
+        gShipSprites[p] = gAtlas->Find(SHIP_SPRITES[p], SHIP_TEXTURES[p]);
+    }
+    gBulletSize = {gBulletSprite->src.w/2, gBulletSprite->src.h/2};
+    gShipSize = {gShipSprites[0]->src.w/2, gShipSprites[0]->src.h/2};
+    gBulletHull = spriteHull(gBulletSprite, loader, 0.5f);
+    gShipHull = spriteHull(gShipSprites[0], loader, 0.5f);
+    gSpriteBatch = new SpriteBatch(gRenderer);
+    gParticles = new ParticleSystem(PARTICLE_CAPACITY);
+    gParticleTexture = createParticleTexture();
+    gParticleVertices.resize(PARTICLE_CAPACITY * 4);
+    Texture *tile = gTextures->Acquire(BACKGROUND_TEXTURE);
+    gBackground = cacheBackground(tile);
+    gTextures->Release(tile);
+    gFont = loader.TakeFont(FONT_PATH);
+
+    gGlyphs = new GlyphAtlas(gRenderer, gFont);
+    gScoreLabel = new TextLabel(gGlyphs);
+    gLivesLabel = new TextLabel(gGlyphs);
+    gWaveLabel = new TextLabel(gGlyphs);
+    gNewWaveLabel = new TextLabel(gGlyphs);
+    gNewWaveLabel->Set("New Wave", gNewWavePos);
+    gGameOverLabel = new TextLabel(gGlyphs);
+    gGameOverLabel->Set("Game Over", gGameOverPos);
+    gGameStartLabel = new TextLabel(gGlyphs);
+    gGameStartLabel->Set("Start Game", gGameStartPos);
+    gGameStartingLabel = new TextLabel(gGlyphs);
+    gGameStartingLabel->Set("Press space to start", gGameStartingPos);
+    gRestartLabel = new TextLabel(gGlyphs);
+    gRestartLabel->Set("Press Escape to restart", gRestartPos);
+    gSimOverlay = new ProfilerOverlay(gRenderer, gGlyphs, 10, 50);
+    gRenderOverlay = new ProfilerOverlay(gRenderer, gGlyphs, WIDTH - 10 - PROFILE_FRAMES * 2, 50);
+
+    if(gDirtyCheck)
+    {
+        gDirtyPixels.resize(WIDTH * HEIGHT);
+        gFullPixels.resize(WIDTH * HEIGHT);
+    }
+
+    SDL_Log("Assets ready after %.1f ms\n", (SDL_GetPerformanceCounter() - gStartupCounter) * 1000.0 / SDL_GetPerformanceFrequency());
+    return true;
+}
+
+// Tiles the background image into a screen-sized target texture. Without
+// render target support, or when the image is missing, the background
+// stays black.
+SDL_Texture *cacheBackground(Texture *tile)
+{
+    SDL_Texture *background = SDL_CreateTexture(gRenderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, WIDTH, HEIGHT);
+    if(background == nullptr)
+    {
+        SDL_Log("Unable to cache the background: %s\n", SDL_GetError());
+        return nullptr;
+    }
 
-        for(auto i=0; i < gAsteroids.size(); i++)
+    SDL_SetRenderTarget(gRenderer, background);
+    SDL_SetRenderDrawColor(gRenderer, 0, 0, 0, 255);
+    SDL_RenderClear(gRenderer);
+    if(tile != nullptr && tile->width > 0 && tile->height > 0)
+    {
+        for(int y=0; y < HEIGHT; y += tile->height)
         {
-            if(gAsteroids[i]->Destroyed())
+            for(int x=0; x < WIDTH; x += tile->width)
             {
-                delete gAsteroids[i];
-                gAsteroids[i] = nullptr;
+                SDL_Rect dst = {x, y, tile->width, tile->height};
+                SDL_RenderCopy(gRenderer, tile->texture, nullptr, &dst);
             }
         }
+    }
+    SDL_SetRenderTarget(gRenderer, nullptr);
+    // Opaque, so copies of it can skip blending.
+    SDL_SetTextureBlendMode(background, SDL_BLENDMODE_NONE);
+    return background;
+}
 
-        gAsteroids.erase(std::remove_if(gAsteroids.begin(), gAsteroids.end(), [](const Asteroid *asteroid) { return asteroid == nullptr; }), gAsteroids.end());
+// White with alpha falling off from the centre; the vertex colours tint it.
+SDL_Texture *createParticleTexture()
+{
+    SDL_Surface *surface = SDL_CreateRGBSurfaceWithFormat(0, PARTICLE_TEXTURE_SIZE, PARTICLE_TEXTURE_SIZE, 32, SDL_PIXELFORMAT_RGBA32);
+    if(surface == nullptr) return nullptr;
 
-        if(gAsteroids.size() == 0)
+    float radius = PARTICLE_TEXTURE_SIZE * 0.5f;
+    for(int y=0; y < PARTICLE_TEXTURE_SIZE; y++)
+    {
+        Uint8 *row = (Uint8*)surface->pixels + y * surface->pitch;
+        for(int x=0; x < PARTICLE_TEXTURE_SIZE; x++)
         {
-            gIsWaveEnd = true;
+            float dx = (x + 0.5f - radius) / radius;
+            float dy = (y + 0.5f - radius) / radius;
+            float falloff = std::max(1.0f - sqrtf(dx*dx + dy*dy), 0.0f);
+            row[x*4] = 255;
+            row[x*4 + 1] = 255;
+            row[x*4 + 2] = 255;
+            row[x*4 + 3] = (Uint8)(255.0f * std::min(falloff * 2.0f, 1.0f));
         }
+    }
 
-        SDL_DestroyTexture(gScoreTexture);
-        gScoreTexture = nullptr;
-        std::string scoreStr = std::to_string(gScore);
-        gScoreTexture = loadText(scoreStr, {255, 255, 255, 255});
-        gScorePos.w = scoreStr.size() * 16;
-        gScorePos.x = WIDTH / 2 - gScorePos.w / 2;
+    SDL_Texture *texture = SDL_CreateTextureFromSurface(gRenderer, surface);
+    SDL_FreeSurface(surface);
+    if(texture != nullptr) SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+    return texture;
+}
 
-        SDL_DestroyTexture(gLivesTexture);
-        gLivesTexture = nullptr;
-        std::string livesStr = std::to_string(gLives);
-        gLivesTexture = loadText(livesStr, {255, 255, 255, 255});
-        gLivesPos.w = livesStr.size() * 16;
-
-        SDL_DestroyTexture(gWaveTexture);
-        gWaveTexture = nullptr;
-        std::string waveStr = std::to_string(gWave);
-        gWaveTexture = loadText(waveStr, {255, 255, 255, 255});
-        gWavePos.w = waveStr.size() * 16;
-        gWavePos.x = WIDTH-20-gWavePos.w;
+// A progress bar, redrawn every frame until the loader has decoded and
+// uploaded everything. Nothing else is loaded yet, so it uses no textures.
+void showLoading(AssetLoader &loader)
+{
+    SDL_Rect frame = {WIDTH/4, HEIGHT/2 - 8, WIDTH/2, 16};
+    while(!loader.Done())
+    {
+        loader.Upload(gTextures, UPLOAD_BUDGET_MS);
 
-        SDL_SetRenderDrawColor(gRenderer, 0, 0, 0, 1);
+        SDL_SetRenderDrawColor(gRenderer, 0, 0, 0, 255);
         SDL_RenderClear(gRenderer);
+        SDL_SetRenderDrawColor(gRenderer, 255, 255, 255, 255);
+        SDL_RenderDrawRect(gRenderer, &frame);
+        SDL_Rect bar = {frame.x + 2, frame.y + 2, (int)((frame.w - 4) * loader.Progress()), frame.h - 4};
+        SDL_RenderFillRect(gRenderer, &bar);
+        present();
+        framePresented();
+    }
+}
+
+// The software renderer draws into the window surface, which is then
+// copied to the screen in full.
+void present()
+{
+    if(gDirtyRects)
+    {
+        SDL_RenderFlush(gRenderer);
+        SDL_UpdateWindowSurface(gWindow);
+    }
+    else
+    {
+        SDL_RenderPresent(gRenderer);
+    }
+}
+
+void framePresented()
+{
+    static bool first = true;
+    if(!first) return;
+    first = false;
+    SDL_Log("First frame after %.1f ms\n", (SDL_GetPerformanceCounter() - gStartupCounter) * 1000.0 / SDL_GetPerformanceFrequency());
+}
 
-        SDL_RenderCopy(gRenderer, gBackgroundTexture, nullptr, nullptr);
+// Empty when the image failed to load, which leaves the simulation on the
+// sprite's rectangle.
+Hull spriteHull(const Sprite *sprite, const AssetLoader &loader, float scale)
+{
+    Hull hull = {};
+    std::vector<Uint8> alpha;
+    if(sprite != nullptr && ReadSpriteAlpha(sprite, loader.Surface(sprite->texture->path), alpha))
+    {
+        hull = BuildHull(alpha.data(), sprite->src.w, sprite->src.h, HULL_ALPHA_THRESHOLD, scale, scale);
+    }
+    return hull;
+}
 
-        for(auto &bullet : gBullets)
+void freeAssets()
+{
+    SDL_Log("Sounds dropped at the voice limit: %u\n", gAudio.Dropped());
+    gAudio.Close();
+    if(gBackground != nullptr) SDL_DestroyTexture(gBackground);
+    gBackground = nullptr;
+    delete gScoreLabel;
+    gScoreLabel = nullptr;
+    delete gLivesLabel;
+    gLivesLabel = nullptr;
+    delete gWaveLabel;
+    gWaveLabel = nullptr;
+    delete gNewWaveLabel;
+    gNewWaveLabel = nullptr;
+    delete gGameOverLabel;
+    gGameOverLabel = nullptr;
+    delete gGameStartLabel;
+    gGameStartLabel = nullptr;
+    delete gGameStartingLabel;
+    gGameStartingLabel = nullptr;
+    delete gRestartLabel;
+    gRestartLabel = nullptr;
+    delete gSimOverlay;
+    gSimOverlay = nullptr;
+    delete gRenderOverlay;
+    gRenderOverlay = nullptr;
+    delete gGlyphs;
+    gGlyphs = nullptr;
+
+    if(gDirtyCheck)
+    {
+        SDL_Log("Dirty rect check: %u of %u frames differ from a full redraw\n", gDirtyMismatches, gDirtyChecked);
+    }
+    SDL_Log("Texture cache: %u hits, %u misses\n", gTextures->Hits(), gTextures->Misses());
+    if(gParticleTexture != nullptr) SDL_DestroyTexture(gParticleTexture);
+    gParticleTexture = nullptr;
+    delete gParticles;
+    gParticles = nullptr;
+    delete gSpriteBatch;
+    gSpriteBatch = nullptr;
+    delete gAtlas;
+    gAtlas = nullptr;
+    delete gTextures;
+    gTextures = nullptr;
+
+    TTF_CloseFont(gFont);
+    SDL_DestroyRenderer(gRenderer);
+    gRenderer = nullptr;
+}
+
+void renderLoop(bool vsync, int refreshRate)
+{
+    Profiler::SetCurrent(&gRenderProfiler);
+    if(!loadAssets(vsync))
+    {
+        gRenderState.store(RENDER_FAILED, std::memory_order_release);
+        return;
+    }
+    gRenderState.store(RENDER_READY, std::memory_order_release);
+
+    Uint64 frequency = SDL_GetPerformanceFrequency();
+    bool haveSnapshot = false;
+    double simFrameStart = 0.0;
+    Uint64 reportedInputTime = 0;
+    Uint64 previousFrame = SDL_GetPerformanceCounter();
+    Uint64 frameTicks = frequency / refreshRate;
+    Uint64 nextFrame = previousFrame;
+
+    while(gRunning.load(std::memory_order_relaxed))
+    {
+        if(gSnapshots.Update())
         {
-            bullet->Draw();
+            haveSnapshot = true;
         }
-        for(auto &asteroid: gAsteroids)
+        if(!haveSnapshot)
         {
-            asteroid->Draw();
+            SDL_Delay(1);
+            continue;
         }
-        gShip->Draw();
-
-        SDL_RenderCopy(gRenderer, gScoreTexture, nullptr, &gScorePos);
-        SDL_RenderCopy(gRenderer, gLivesTexture, nullptr, &gLivesPos);
-        SDL_RenderCopy(gRenderer, gWaveTexture, nullptr, &gWavePos);
+        const Snapshot &snapshot = gSnapshots.Front();
 
-        if(!gIsGameStarted)
+        gRenderProfiler.SetEnabled(snapshot.profiling);
+        if(snapshot.profiling && snapshot.simFrameStart != simFrameStart)
         {
-            SDL_RenderCopy(gRenderer, gGameStartingTexture, nullptr, &gGameStartingPos);
-            SDL_RenderCopy(gRenderer, gGameStartTexture, nullptr, &gGameStartPos);
+            simFrameStart = snapshot.simFrameStart;
+            gSimProfilerView.Push(snapshot.simFrameStart, snapshot.simFrameDuration, snapshot.simPhases);
         }
-        else if(gIsWaveEnd)
+
+        gRenderProfiler.BeginFrame();
+        Uint64 now = SDL_GetPerformanceCounter();
+        updateParticles((float)std::min((now - previousFrame) * 1000.0 / frequency, MAX_FRAME_TIME));
+        previousFrame = now;
+        double sinceTick = (double)(SDL_GetPerformanceCounter() - snapshot.tickTime) * 1000.0 / frequency;
+        float alpha = std::min(std::max((float)(sinceTick / TICK_INTERVAL), 0.0f), 1.0f);
+        render(snapshot, alpha);
+        gAudio.Play(gSounds);
+        gRenderProfiler.EndFrame();
+
+        if(snapshot.inputTime != 0 && snapshot.inputTime != reportedInputTime)
         {
-            SDL_RenderCopy(gRenderer, gNewWaveTexture, nullptr, &gNewWavePos);
+            reportedInputTime = snapshot.inputTime;
+            gLatency.Add((double)(SDL_GetPerformanceCounter() - snapshot.inputTime) * 1000.0 / frequency);
         }
 
-        if(gGameOver)
+        // Nothing paces the software renderer, so without this it redraws
+        // flat out. Frames are due a display refresh apart; falling behind
+        // restarts the schedule rather than rushing to catch up.
+        if(gDirtyRects)
         {
-            SDL_RenderCopy(gRenderer, gGameOverTexture, nullptr, &gGameOverPos);
-            SDL_RenderCopy(gRenderer, gRestartTexture, nullptr, &gRestartPos);
+            nextFrame += frameTicks;
+            Uint64 current = SDL_GetPerformanceCounter();
+            if(nextFrame > current) SDL_Delay((Uint32)((nextFrame - current) * 1000 / frequency));
+            else nextFrame = current;
         }
-
-        SDL_RenderPresent(gRenderer);
-        SDL_Delay(time_left());
-        next_time += TICK_INTERVAL;
     }
 
-    clear();
-
-    SDL_DestroyTexture(gBackgroundTexture);
-    gBackgroundTexture = nullptr;
-    SDL_DestroyTexture(gNewWaveTexture);
-    gNewWaveTexture = nullptr;
-    SDL_DestroyTexture(gGameOverTexture);
-    gGameOverTexture = nullptr;
-    SDL_DestroyTexture(gGameStartTexture);
-    gGameStartTexture = nullptr;
-    SDL_DestroyTexture(gGameStartingTexture);
-    gGameStartingTexture = nullptr;
-    SDL_DestroyTexture(gRestartTexture);
-    gRestartTexture = nullptr;
-
-    TTF_CloseFont(gFont);
-    SDL_DestroyRenderer(gRenderer);
-    SDL_DestroyWindow(gWindow);
-
-    return 0;
+    freeAssets();
 }
 
-bool collide(SDL_Rect a, SDL_Rect b)
+void drawTransform(const Sprite *sprite, const WrapTransforms &transforms, size_t i, float dx, float dy)
 {
+    // Floored rather than truncated, so a ghost left of or above the screen
+    // lines up with the pixel its original starts on.
+    SDL_Rect dstrect = {(int)floorf(transforms.x[i] + dx), (int)floorf(transforms.y[i] + dy), transforms.width[i], transforms.height[i]};
+    gSpriteBatch->Draw(sprite, dstrect, transforms.angle[i]-90);
+}
 
-	float aLeft = a.x;
-	float aRight = a.x + a.w;
-	float aTop = a.y;
-	float aBottom = a.y + a.h;
-
-	float bLeft = b.x;
-	float bRight = b.x + b.w;
-	float bTop = b.y;
-	float bBottom = b.y + b.h;
+void drawAsteroids(const Snapshot &snapshot, float alpha)
+{
+    size_t count = snapshot.asteroidX.size();
+    WrapTransforms &transforms = gAsteroidTransforms;
+    transforms.Resize(count);
+    for(size_t i=0; i < count; i++)
+    {
+        transforms.x[i] = interpolateWrapped(snapshot.asteroidPrevX[i], snapshot.asteroidX[i], alpha, WIDTH);
+        transforms.y[i] = interpolateWrapped(snapshot.asteroidPrevY[i], snapshot.asteroidY[i], alpha, HEIGHT);
+        transforms.angle[i] = interpolateAngle(snapshot.asteroidPrevAngle[i], snapshot.asteroidAngle[i], alpha);
+    }
+    memcpy(transforms.width.data(), snapshot.asteroidWidth.data(), count * sizeof(int));
+    memcpy(transforms.height.data(), snapshot.asteroidHeight.data(), count * sizeof(int));
+    transforms.ghosts.Build(transforms.x.data(), transforms.y.data(), transforms.width.data(), transforms.height.data(), count, WIDTH, HEIGHT);
 
-	if (aLeft >= bRight)
-	{
-		return false;
-	}
+    for(size_t i=0; i < count; i++)
+    {
+        drawTransform(gAsteroidSprites[snapshot.asteroidType[i]], transforms, i, 0, 0);
+    }
+    for(const Ghost &ghost : transforms.ghosts.Ghosts())
+    {
+        drawTransform(gAsteroidSprites[snapshot.asteroidType[ghost.id]], transforms, ghost.id, ghost.dx, ghost.dy);
+    }
+}
 
-	if (aRight <= bLeft)
-	{
-		return false;
-	}
+void drawShip(const Snapshot &snapshot, float alpha)
+{
+    WrapTransforms &transforms = gShipTransforms;
+    transforms.Resize(MAX_SHIPS);
+    for(int s=0; s < snapshot.shipCount; s++)
+    {
+        const ShipView &ship = snapshot.ships[s];
+        transforms.x[s] = interpolateWrapped(ship.prevPos.x, ship.pos.x, alpha, WIDTH);
+        transforms.y[s] = interpolateWrapped(ship.prevPos.y, ship.pos.y, alpha, HEIGHT);
+        transforms.angle[s] = interpolateAngle(ship.prevAngle, ship.angle, alpha);
+        // A destroyed ship has no size, so it never has ghosts either.
+        transforms.width[s] = ship.destroyed ? 0 : ship.width;
+        transforms.height[s] = ship.destroyed ? 0 : ship.height;
+    }
+    transforms.ghosts.Build(transforms.x.data(), transforms.y.data(), transforms.width.data(), transforms.height.data(),
+                            snapshot.shipCount, WIDTH, HEIGHT);
 
-	if (aTop >= bBottom)
-	{
-		return false;
-	}
+    for(int s=0; s < snapshot.shipCount; s++)
+    {
+        if(!snapshot.ships[s].destroyed) drawTransform(gShipSprites[s], transforms, s, 0, 0);
+    }
+    for(const Ghost &ghost : transforms.ghosts.Ghosts())
+    {
+        drawTransform(gShipSprites[ghost.id], transforms, ghost.id, ghost.dx, ghost.dy);
+    }
+}
 
-	if (aBottom <= bTop)
-	{
-		return false;
-	}
+static_assert(sizeof(ParticleVertex) == sizeof(SDL_Vertex) &&
+              offsetof(ParticleVertex, r) == offsetof(SDL_Vertex, color) &&
+              offsetof(ParticleVertex, u) == offsetof(SDL_Vertex, tex_coord),
+              "ParticleVertex must match SDL_Vertex");
 
-    return true;
+// Every live particle in one quad run on one texture, so the whole system
+// is a single SDL_RenderGeometry call.
+void drawParticles()
+{
+    if(gParticleTexture == nullptr) return;
+    size_t quads = gParticles->Build(reinterpret_cast<ParticleVertex*>(gParticleVertices.data()));
+    if(quads != 0) gSpriteBatch->DrawQuads(gParticleTexture, gParticleVertices.data(), (int)quads);
 }
 
-void createNewAsteroids(Vector2 pos, AsteroidType type)
+// Turns the effects emitted since the last frame into particles and moves
+// them on by the frame's real time.
+void updateParticles(float ms)
 {
-        Vector2 velocity = Vector2(rand()%10 * 0.3f,  rand()%10 * 0.3f);
-        Asteroid *a1 = new Asteroid(gRenderer, pos, type);
-        a1->SetVelocity(velocity);
-        velocity = Vector2(rand()%10 * -0.3f,  rand()%10 * -0.3f);
-        Asteroid *a2 = new Asteroid(gRenderer, pos, type);
-        a2->SetVelocity(velocity);
-        gAsteroids.push_back(a1);
-        gAsteroids.push_back(a2);
+    PROFILE_SCOPE(PHASE_PARTICLES);
+    Effect effect;
+    while(gEffects.Pop(effect))
+    {
+        gParticles->Emit(effect);
+    }
+    gParticles->Update(ms);
 }
 
-void startGame()
+void drawBullets(const Snapshot &snapshot, float alpha)
 {
-    gIsGameStarted = true;
-    startWave();
+    for(size_t i=0; i < snapshot.bulletX.size(); i++)
+    {
+        float x = interpolate(snapshot.bulletPrevX[i], snapshot.bulletX[i], alpha, WIDTH);
+        float y = interpolate(snapshot.bulletPrevY[i], snapshot.bulletY[i], alpha, HEIGHT);
+        SDL_Rect dstrect = {(int)x, (int)y, snapshot.bulletWidth[i], snapshot.bulletHeight[i]};
+        gSpriteBatch->Draw(gBulletSprite, dstrect, snapshot.bulletAngle[i]-90);
+    }
 }
 
-void restartGame()
+void render(const Snapshot &snapshot, float alpha)
 {
-    gGameOver = false;
-    gIsGameStarted = false;
-    gIsWaveEnd = true;
-    gWave = 0;
-    gLives = 2;
-    gScore = 0;
-    gNewWaveTimer = 0.0;
-    clear();
-    gShip = new Ship(gRenderer);
+    updateHud(snapshot);
+    if(!gDirtyRects)
+    {
+        draw(snapshot, alpha, nullptr);
+
+        PROFILE_SCOPE(PHASE_PRESENT);
+        SDL_RenderPresent(gRenderer);
+        framePresented();
+        return;
+    }
+
+    // Everything drawn this frame lands on the background restored under
+    // last frame's rects, so the result matches a full redraw.
+    gSpriteBatch->Track(&gDirty);
+    draw(snapshot, alpha, &gDirty.Stale());
+    gSpriteBatch->Track(nullptr);
+    if(gDirtyCheck) checkDirtyFrame(snapshot, alpha);
+
+    // The window surface is drawn and copied out from this thread only.
+    // The main thread never touches it, and the window can't be resized,
+    // so SDL never frees or replaces the surface under us. The copy goes
+    // through the same video driver connection as the main thread's event
+    // pump, which SDL sets up for use from several threads (its X11 driver
+    // calls XInitThreads), just as for SDL_RenderPresent on the
+    // accelerated path.
+    {
+        PROFILE_SCOPE(PHASE_PRESENT);
+        const std::vector<SDL_Rect> &changed = gDirty.Changed();
+        SDL_RenderFlush(gRenderer);
+        SDL_UpdateWindowSurfaceRects(gWindow, changed.data(), (int)changed.size());
+        framePresented();
+    }
+    gDirty.Swap();
 }
 
-void startWave()
+// Reads back the dirty rect frame, redraws it in full over it and compares.
+// The full redraw is what stays on screen.
+void checkDirtyFrame(const Snapshot &snapshot, float alpha)
 {
-    if(gNewWaveTimer >= gNewWaveTime)
+    SDL_RenderReadPixels(gRenderer, nullptr, SDL_PIXELFORMAT_ARGB8888, gDirtyPixels.data(), WIDTH * 4);
+    draw(snapshot, alpha, nullptr);
+    SDL_RenderReadPixels(gRenderer, nullptr, SDL_PIXELFORMAT_ARGB8888, gFullPixels.data(), WIDTH * 4);
+
+    gDirtyChecked++;
+    size_t differ = 0;
+    for(size_t i=0; i < gFullPixels.size(); i++)
     {
-        gWave++;
-        gIsWaveEnd = false;
-        gNewWaveTimer = 0.0f;
-        int n = std::min(gWave+2, MAX_BIG_ASTEROIDS);
-        int xRange = 50 + 50 + 1;
-        int yRange = 50 + 50 + 1;
-        for(int i=0; i < n; i++)
-        {
-            int x = (int)(cos(2 * 3.14 * i / n) * 350 + 0.5) + WIDTH/2 - 50 + rand() % xRange - 50;
-            int y = (int)(sin(2 * 3.14 * i / n) * 350 + 0.5) + HEIGHT/2 - 40 + rand() % yRange - 50;
-            Vector2 pos = Vector2(+x, +y);
-            Asteroid *asteroid = new Asteroid(gRenderer, pos, BIG);
-            gAsteroids.push_back(asteroid);
-        }
+        if(gDirtyPixels[i] != gFullPixels[i]) differ++;
     }
-    else
+    if(differ != 0)
     {
-        gNewWaveTimer += TICK_INTERVAL;
+        gDirtyMismatches++;
+        SDL_Log("Dirty rect frame %u differs from a full redraw in %zu pixels\n", gDirtyChecked, differ);
+        gDirty.Invalidate();
     }
 }
 
-SDL_Texture *loadText(std::string text, SDL_Color color)
+// stale lists the rects to restore the background in, nullptr restores all
+// of it.
+void draw(const Snapshot &snapshot, float alpha, const std::vector<SDL_Rect> *stale)
 {
-    SDL_Texture *newTexture = nullptr;
-
-    SDL_Surface *loadedSurface = TTF_RenderText_Solid(gFont, text.c_str(), color);
-    if(loadedSurface == nullptr)
+    PROFILE_SCOPE(PHASE_DRAW);
+    if(gBackground == nullptr)
+    {
+        SDL_SetRenderDrawColor(gRenderer, 0, 0, 0, 255);
+        SDL_RenderClear(gRenderer);
+    }
+    else if(stale == nullptr)
     {
-        SDL_Log("Unable to create text %s! SDL_ttf Error: %s\n", text.c_str(), TTF_GetError());
+        SDL_RenderCopy(gRenderer, gBackground, nullptr, nullptr);
     }
     else
     {
-        newTexture = SDL_CreateTextureFromSurface(gRenderer, loadedSurface);
-        if( newTexture == nullptr )
+        for(const SDL_Rect &rect : *stale)
         {
-            SDL_Log( "Unable to create text from %s! SDL Error: %s\n", text.c_str(), SDL_GetError() );
+            SDL_RenderCopy(gRenderer, gBackground, &rect, &rect);
         }
+    }
+
+    drawBullets(snapshot, alpha);
+    drawAsteroids(snapshot, alpha);
+    drawParticles();
+    drawShip(snapshot, alpha);
 
-        SDL_FreeSurface(loadedSurface);
+    gScoreLabel->Draw(gSpriteBatch);
+    gLivesLabel->Draw(gSpriteBatch);
+    gWaveLabel->Draw(gSpriteBatch);
+
+    if(!snapshot.started)
+    {
+        gGameStartingLabel->Draw(gSpriteBatch);
+        gGameStartLabel->Draw(gSpriteBatch);
+    }
+    else if(snapshot.waveEnd)
+    {
+        gNewWaveLabel->Draw(gSpriteBatch);
+    }
+
+    if(snapshot.gameOver)
+    {
+        gGameOverLabel->Draw(gSpriteBatch);
+        gRestartLabel->Draw(gSpriteBatch);
     }
+    gSpriteBatch->Flush();
 
-    return newTexture;
+    if(snapshot.showProfiler)
+    {
+        gSimOverlay->Draw(gSimProfilerView, gSpriteBatch);
+        gRenderOverlay->Draw(gRenderProfiler, gSpriteBatch);
+        gSpriteBatch->Flush();
+    }
 }
 
-void clear()
+void updateHud(const Snapshot &snapshot)
 {
-    for(auto i=0; i<gAsteroids.size(); i++)
+    PROFILE_SCOPE(PHASE_HUD);
+
+    // Only re-lay out the numbers that changed since the last frame.
+    char text[16];
+    if(snapshot.score != gHudScore)
+    {
+        gHudScore = snapshot.score;
+        int length = snprintf(text, sizeof(text), "%d", snapshot.score);
+        gScorePos.w = length * 16;
+        gScorePos.x = WIDTH / 2 - gScorePos.w / 2;
+        gScoreLabel->Set(text, gScorePos);
+    }
+
+    if(snapshot.lives != gHudLives)
     {
-        delete gAsteroids[i];
-        gAsteroids[i] = nullptr;
+        gHudLives = snapshot.lives;
+        int length = snprintf(text, sizeof(text), "%d", snapshot.lives);
+        gLivesPos.w = length * 16;
+        gLivesLabel->Set(text, gLivesPos);
     }
-    gAsteroids.clear();
 
-    for(auto i=0; i<gBullets.size(); i++)
+    if(snapshot.wave != gHudWave)
     {
-        delete gBullets[i];
-        gBullets[i] = nullptr;
+        gHudWave = snapshot.wave;
+        int length = snprintf(text, sizeof(text), "%d", snapshot.wave);
+        gWavePos.w = length * 16;
+        gWavePos.x = WIDTH-20-gWavePos.w;
+        gWaveLabel->Set(text, gWavePos);
     }
-    gBullets.clear();
+}
+
+float interpolate(float previous, float current, float alpha, float span)
+{
+    // A jump of more than half the playfield is a wrap or a respawn, not
+    // motion; snap instead of sweeping across the screen.
+    if(fabsf(current - previous) > span / 2) return current;
+    return previous + (current - previous) * alpha;
+}
+
+// interpolate on the torus: a move across a seam takes the short way round
+// and the result is wrapped back into the playfield, where the ghosts show
+// whatever hangs past the edge. A jump still longer than a quarter of the
+// playfield is a respawn; snap instead of sweeping across the screen.
+float interpolateWrapped(float previous, float current, float alpha, float span)
+{
+    float delta = current - previous;
+    if(delta > span / 2) delta -= span;
+    else if(delta < -span / 2) delta += span;
+    if(fabsf(delta) > span / 4) return current;
+
+    float value = previous + delta * alpha;
+    if(value < 0) value += span;
+    else if(value >= span) value -= span;
+    return value;
+}
 
-    delete gShip;
-    gShip = nullptr;
-}
\ No newline at end of file
+float interpolateAngle(float previous, float current, float alpha)
+{
+    float delta = fmodf(current - previous, 360.0f);
+    if(delta > 180.0f) delta -= 360.0f;
+    else if(delta < -180.0f) delta += 360.0f;
+    return previous + delta * alpha;
+}
@@ -0,0 +1,114 @@
+#include "particles.h"
+#include <algorithm>
+#include <math.h>
+
+#define DEG_TO_RAD (3.14159265f / 180.0f)
+
+// Indexed by EffectKind: debris for big, medium and small asteroids, then
+// the ship's exhaust.
+const Emitter EMITTERS[EFFECT_KINDS] = {
+    {28, 180.0f, 0.04f, 0.12f, 600.0f, 500.0f, 3.0f, 0.5f, 0.0015f, 190, 170, 150},
+    {18, 180.0f, 0.04f, 0.10f, 500.0f, 400.0f, 2.5f, 0.5f, 0.0015f, 190, 170, 150},
+    {10, 180.0f, 0.03f, 0.08f, 400.0f, 300.0f, 2.0f, 0.5f, 0.0015f, 190, 170, 150},
+    {4, 15.0f, 0.15f, 0.10f, 180.0f, 120.0f, 2.5f, 1.0f, 0.004f, 255, 170, 60},
+};
+
+static inline float unit(Rng &rng)
+{
+    return (rng.Next() >> 8) * (1.0f / 16777216.0f);
+}
+
+ParticleSystem::ParticleSystem(size_t capacity)
+{
+    x.resize(capacity);
+    y.resize(capacity);
+    vx.resize(capacity);
+    vy.resize(capacity);
+    age.resize(capacity);
+    fade.resize(capacity);
+    size.resize(capacity);
+    drag.resize(capacity);
+    color.resize(capacity);
+    mHead = 0;
+    mUsed = 0;
+    mLive = 0;
+    mRng.Seed(0x5eed);
+}
+
+void ParticleSystem::Emit(const Effect &effect)
+{
+    if(x.empty()) return;
+
+    const Emitter &emitter = EMITTERS[effect.kind];
+    float baseX = effect.vx * emitter.inherit / TICK_INTERVAL;
+    float baseY = effect.vy * emitter.inherit / TICK_INTERVAL;
+    uint32_t rgb = (uint32_t)emitter.r | (uint32_t)emitter.g << 8 | (uint32_t)emitter.b << 16;
+    for(int n=0; n < emitter.count; n++)
+    {
+        size_t i = mHead;
+        mHead = (mHead + 1) % x.size();
+        mUsed = std::max(mUsed, mHead == 0 ? x.size() : mHead);
+
+        float angle = (effect.angle + (unit(mRng) * 2.0f - 1.0f) * emitter.spread) * DEG_TO_RAD;
+        float speed = emitter.speed + unit(mRng) * emitter.speedJitter;
+        x[i] = effect.x;
+        y[i] = effect.y;
+        vx[i] = baseX + cosf(angle) * speed;
+        vy[i] = baseY + sinf(angle) * speed;
+        age[i] = 0.0f;
+        fade[i] = 1.0f / (emitter.life + unit(mRng) * emitter.lifeJitter);
+        size[i] = emitter.size;
+        drag[i] = emitter.drag;
+        color[i] = rgb;
+    }
+}
+
+void ParticleSystem::Update(float ms)
+{
+    // Dead particles are moved too; a branch-free loop over every used slot
+    // vectorises, and skipping them would not.
+    size_t live = 0;
+    for(size_t i=0; i < mUsed; i++)
+    {
+        float keep = std::max(1.0f - drag[i] * ms, 0.0f);
+        x[i] += vx[i] * ms;
+        y[i] += vy[i] * ms;
+        vx[i] *= keep;
+        vy[i] *= keep;
+        age[i] += ms * fade[i];
+        live += age[i] < 1.0f;
+    }
+    mLive = live;
+}
+
+size_t ParticleSystem::Build(ParticleVertex *vertices) const
+{
+    size_t quads = 0;
+    for(size_t i=0; i < mUsed; i++)
+    {
+        if(age[i] >= 1.0f) continue;
+
+        uint8_t alpha = (uint8_t)(255.0f - 255.0f * age[i]);
+        uint8_t r = (uint8_t)color[i];
+        uint8_t g = (uint8_t)(color[i] >> 8);
+        uint8_t b = (uint8_t)(color[i] >> 16);
+        float half = size[i] * 0.5f;
+        float left = x[i] - half;
+        float top = y[i] - half;
+        float right = x[i] + half;
+        float bottom = y[i] + half;
+
+        ParticleVertex *quad = vertices + quads * 4;
+        quad[0] = {left, top, r, g, b, alpha, 0.0f, 0.0f};
+        quad[1] = {right, top, r, g, b, alpha, 1.0f, 0.0f};
+        quad[2] = {right, bottom, r, g, b, alpha, 1.0f, 1.0f};
+        quad[3] = {left, bottom, r, g, b, alpha, 0.0f, 1.0f};
+        quads++;
+    }
+    return quads;
+}
+
+size_t ParticleSystem::Memory() const
+{
+    return x.capacity() * (8 * sizeof(float) + sizeof(uint32_t));
+}
@@ -0,0 +1,94 @@
+#ifndef PARTICLES_H
+#define PARTICLES_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include "simulation.h"
+#include "rng.h"
+
+// Laid out like SDL_Vertex so a built batch goes to SDL_RenderGeometry
+// without a copy, while the particle code itself needs no SDL.
+struct ParticleVertex {
+    float x;
+    float y;
+    uint8_t r;
+    uint8_t g;
+    uint8_t b;
+    uint8_t a;
+    float u;
+    float v;
+};
+
+// What one effect sprays: count particles within spread degrees either
+// side of the effect's angle, at speed pixels a millisecond plus up to
+// speedJitter more, living life plus up to lifeJitter milliseconds.
+// inherit is the share of the emitter's velocity they keep, drag the share
+// of their velocity lost each millisecond.
+struct Emitter {
+    int count;
+    float spread;
+    float speed;
+    float speedJitter;
+    float life;
+    float lifeJitter;
+    float size;
+    float inherit;
+    float drag;
+    uint8_t r;
+    uint8_t g;
+    uint8_t b;
+};
+
+extern const Emitter EMITTERS[EFFECT_KINDS];
+
+// Short-lived, purely visual particles in a fixed-capacity ring of SoA
+// arrays. Emitting into a full ring overwrites the oldest particles, so
+// nothing is ever allocated after construction. Alpha fades out over each
+// particle's life.
+class ParticleSystem
+{
+    public:
+        ParticleSystem(size_t capacity);
+
+        void Emit(const Effect &effect);
+        void Update(float ms);
+        // Four vertices a live particle, clockwise from the top-left, with
+        // texture coordinates spanning the whole texture. vertices must hold
+        // Capacity() * 4. Returns the quads written.
+        size_t Build(ParticleVertex *vertices) const;
+
+        // Particles still alive after the last Update.
+        size_t Live() const
+        {
+            return mLive;
+        }
+
+        size_t Capacity() const
+        {
+            return x.size();
+        }
+
+        size_t Memory() const;
+
+    private:
+        std::vector<float> x;
+        std::vector<float> y;
+        std::vector<float> vx;
+        std::vector<float> vy;
+        // Age as a share of the particle's life, and that share a millisecond.
+        std::vector<float> age;
+        std::vector<float> fade;
+        std::vector<float> size;
+        std::vector<float> drag;
+        std::vector<uint32_t> color;
+
+        // Next slot to write and how many slots have ever been written.
+        size_t mHead;
+        size_t mUsed;
+        size_t mLive;
+        // Separate from gRng so effects never change the simulation.
+        Rng mRng;
+};
+
+#endif
@@ -0,0 +1,142 @@
+#include "profiler.h"
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+
+Profiler gProfiler("simulation");
+
+static thread_local Profiler *sCurrent = &gProfiler;
+
+static const char *PHASE_NAMES[PHASE_COUNT] = {
+    "events",
+    "start wave",
+    "update",
+    "ship collision",
+    "bullet collision",
+    "compact",
+    "hud",
+    "particles",
+    "draw",
+    "present",
+};
+
+static const std::chrono::steady_clock::time_point sEpoch = std::chrono::steady_clock::now();
+
+const char *ProfilePhaseName(int phase)
+{
+    if(phase < 0 || phase >= PHASE_COUNT) return "unknown";
+    return PHASE_NAMES[phase];
+}
+
+Profiler::Profiler(const char *name)
+{
+    mName = name;
+    mEnabled = false;
+    mInFrame = false;
+    mHead = 0;
+    mCount = 0;
+    memset(mFrames, 0, sizeof(mFrames));
+}
+
+Profiler *Profiler::Current()
+{
+    return sCurrent;
+}
+
+void Profiler::SetCurrent(Profiler *profiler)
+{
+    sCurrent = profiler;
+}
+
+double Profiler::Now() const
+{
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - sEpoch).count();
+}
+
+void Profiler::BeginFrame()
+{
+    if(!mEnabled) return;
+    ProfileFrame &frame = mFrames[mHead];
+    frame.start = Now();
+    frame.duration = 0.0f;
+    memset(frame.phases, 0, sizeof(frame.phases));
+    frame.eventCount = 0;
+    mInFrame = true;
+}
+
+void Profiler::EndFrame()
+{
+    if(!mInFrame) return;
+    ProfileFrame &frame = mFrames[mHead];
+    frame.duration = (float)(Now() - frame.start);
+    mHead = (mHead + 1) % PROFILE_FRAMES;
+    if(mCount < PROFILE_FRAMES) mCount++;
+    mInFrame = false;
+}
+
+void Profiler::Record(ProfilePhase phase, double start, double end)
+{
+    if(!mInFrame) return;
+    ProfileFrame &frame = mFrames[mHead];
+    float duration = (float)(end - start);
+    frame.phases[phase] += duration;
+    if(frame.eventCount < PROFILE_MAX_EVENTS)
+    {
+        frame.events[frame.eventCount++] = {start, duration, (uint8_t)phase};
+    }
+}
+
+void Profiler::Push(double start, float duration, const float *phases)
+{
+    ProfileFrame &frame = mFrames[mHead];
+    frame.start = start;
+    frame.duration = duration;
+    memcpy(frame.phases, phases, sizeof(frame.phases));
+    frame.eventCount = 0;
+    mHead = (mHead + 1) % PROFILE_FRAMES;
+    if(mCount < PROFILE_FRAMES) mCount++;
+}
+
+const ProfileFrame &Profiler::Frame(size_t age) const
+{
+    return mFrames[(mHead + PROFILE_FRAMES - 1 - age) % PROFILE_FRAMES];
+}
+
+bool Profiler::WriteChromeTrace(const char *path, const Profiler *const *profilers, int count)
+{
+    FILE *file = fopen(path, "w");
+    if(file == nullptr)
+    {
+        fprintf(stderr, "Unable to open %s for writing\n", path);
+        return false;
+    }
+
+    fprintf(file, "{\"traceEvents\":[\n");
+    for(int i=0; i < count; i++)
+    {
+        if(i > 0) fprintf(file, ",\n");
+        profilers[i]->AppendChromeTrace(file, 2 * i + 1);
+    }
+    fprintf(file, "\n],\"displayTimeUnit\":\"ms\"}\n");
+    fclose(file);
+    return true;
+}
+
+void Profiler::AppendChromeTrace(FILE *file, int track) const
+{
+    // Complete ("X") events: frames on one track, phases on the next.
+    fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s frames\"}},\n", track, mName);
+    fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s phases\"}}", track + 1, mName);
+    for(size_t age=mCount; age-- > 0;)
+    {
+        const ProfileFrame &frame = Frame(age);
+        fprintf(file, ",\n{\"name\":\"frame\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                track, frame.start, frame.duration);
+        for(uint16_t i=0; i < frame.eventCount; i++)
+        {
+            const ProfileEvent &event = frame.events[i];
+            fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                    ProfilePhaseName(event.phase), track + 1, event.start, event.duration);
+        }
+    }
+}
@@ -0,0 +1,133 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <stdio.h>
+
+#define PROFILE_FRAMES 240
+#define PROFILE_MAX_EVENTS 128
+
+enum ProfilePhase {
+    PHASE_EVENTS,
+    PHASE_START_WAVE,
+    PHASE_UPDATE,
+    PHASE_SHIP_COLLISION,
+    PHASE_BULLET_COLLISION,
+    PHASE_COMPACT,
+    PHASE_HUD,
+    PHASE_PARTICLES,
+    PHASE_DRAW,
+    PHASE_PRESENT,
+    PHASE_COUNT,
+};
+
+const char *ProfilePhaseName(int phase);
+
+// One timed scope. Times are microseconds since the profiler started.
+struct ProfileEvent {
+    double start;
+    float duration;
+    uint8_t phase;
+};
+
+struct ProfileFrame {
+    double start;
+    float duration;
+    float phases[PHASE_COUNT];
+    uint16_t eventCount;
+    ProfileEvent events[PROFILE_MAX_EVENTS];
+};
+
+// Keeps the last PROFILE_FRAMES frames in a fixed ring so recording never
+// allocates. A phase can run several times a frame (one per catch-up tick);
+// phases[] holds the total and events[] each run. A profiler belongs to one
+// thread; PROFILE_SCOPE records into the calling thread's Current().
+class Profiler
+{
+    public:
+        Profiler(const char *name);
+
+        const char *Name() const
+        {
+            return mName;
+        }
+
+        bool Enabled() const
+        {
+            return mEnabled.load(std::memory_order_relaxed);
+        }
+
+        void SetEnabled(bool enabled)
+        {
+            mEnabled.store(enabled, std::memory_order_relaxed);
+        }
+
+        static Profiler *Current();
+        static void SetCurrent(Profiler *profiler);
+
+        double Now() const;
+        void BeginFrame();
+        void EndFrame();
+        void Record(ProfilePhase phase, double start, double end);
+        // Append a finished frame measured elsewhere, without its events.
+        void Push(double start, float duration, const float *phases);
+
+        size_t FrameCount() const
+        {
+            return mCount;
+        }
+
+        // age 0 is the last completed frame.
+        const ProfileFrame &Frame(size_t age) const;
+
+        // Write every frame in the rings of count profilers as Chrome trace
+        // event JSON, one pair of tracks per profiler, loadable in
+        // chrome://tracing or Perfetto.
+        static bool WriteChromeTrace(const char *path, const Profiler *const *profilers, int count);
+
+    private:
+        void AppendChromeTrace(FILE *file, int track) const;
+
+        const char *mName;
+        std::atomic<bool> mEnabled;
+        bool mInFrame;
+        size_t mHead;
+        size_t mCount;
+        ProfileFrame mFrames[PROFILE_FRAMES];
+};
+
+// The simulation thread's profiler, and Current() for any thread that has
+// not picked its own.
+extern Profiler gProfiler;
+
+class ProfileScope
+{
+    public:
+        ProfileScope(ProfilePhase phase)
+        {
+            mProfiler = Profiler::Current();
+            mPhase = phase;
+            mStart = mProfiler->Enabled() ? mProfiler->Now() : -1.0;
+        }
+
+        ~ProfileScope()
+        {
+            if(mStart >= 0.0)
+            {
+                mProfiler->Record(mPhase, mStart, mProfiler->Now());
+            }
+        }
+
+    private:
+        Profiler *mProfiler;
+        ProfilePhase mPhase;
+        double mStart;
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_SCOPE(phase) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(phase)
+
+#endif
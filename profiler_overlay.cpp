@@ -0,0 +1,150 @@
+#include "profiler_overlay.h"
+#include "game.h"
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+
+#define OVERLAY_BAR_WIDTH 2
+#define OVERLAY_GRAPH_HEIGHT 132
+// Graph pixels per millisecond; the top of the graph is 33 ms.
+#define OVERLAY_PIXELS_PER_MS 4.0f
+#define OVERLAY_LEGEND_INTERVAL 30
+// The legend averages the frames that started within this many
+// microseconds of the newest frame's end, whatever the frame rate.
+#define OVERLAY_LEGEND_WINDOW 1000000.0
+#define OVERLAY_TEXT_WIDTH 7
+#define OVERLAY_TEXT_HEIGHT 12
+
+static const SDL_Color PHASE_COLORS[PHASE_COUNT] = {
+    {120, 120, 120, 255},
+    {255, 255, 255, 255},
+    {80, 160, 255, 255},
+    {255, 90, 90, 255},
+    {255, 160, 60, 255},
+    {200, 110, 255, 255},
+    {255, 230, 80, 255},
+    {255, 120, 200, 255},
+    {80, 220, 120, 255},
+    {60, 200, 200, 255},
+};
+
+ProfilerOverlay::ProfilerOverlay(SDL_Renderer *renderer, const GlyphAtlas *glyphs, int x, int y)
+{
+    mRenderer = renderer;
+    mX = x;
+    mY = y;
+    mFrameLabel = new TextLabel(glyphs);
+    for(int i=0; i < PHASE_COUNT; i++)
+    {
+        mPhaseLabels[i] = new TextLabel(glyphs);
+    }
+    mFramesUntilLegend = 0;
+}
+
+ProfilerOverlay::~ProfilerOverlay()
+{
+    delete mFrameLabel;
+    for(int i=0; i < PHASE_COUNT; i++)
+    {
+        delete mPhaseLabels[i];
+    }
+}
+
+void ProfilerOverlay::UpdateLegend(const Profiler &profiler)
+{
+    size_t count = profiler.FrameCount();
+    if(count == 0) return;
+
+    const ProfileFrame &newest = profiler.Frame(0);
+    double windowStart = newest.start + newest.duration - OVERLAY_LEGEND_WINDOW;
+    float total = 0.0f;
+    float phases[PHASE_COUNT] = {};
+    size_t frames = 0;
+    for(; frames < count; frames++)
+    {
+        const ProfileFrame &frame = profiler.Frame(frames);
+        if(frames > 0 && frame.start < windowStart) break;
+        total += frame.duration;
+        for(int i=0; i < PHASE_COUNT; i++)
+        {
+            phases[i] += frame.phases[i];
+        }
+    }
+
+    char text[MAX_LABEL_LENGTH];
+    int y = mY + OVERLAY_GRAPH_HEIGHT + 6;
+    float frameMs = total / frames / 1000.0f;
+    int length = snprintf(text, sizeof(text), "%s %.2f ms", profiler.Name(), frameMs);
+    mFrameLabel->Set(text, {mX, y, length * OVERLAY_TEXT_WIDTH, OVERLAY_TEXT_HEIGHT});
+    for(int i=0; i < PHASE_COUNT; i++)
+    {
+        y += OVERLAY_TEXT_HEIGHT + 2;
+        length = snprintf(text, sizeof(text), "%s %.3f ms", ProfilePhaseName(i), phases[i] / frames / 1000.0f);
+        mPhaseLabels[i]->Set(text, {mX + 14, y, length * OVERLAY_TEXT_WIDTH, OVERLAY_TEXT_HEIGHT});
+    }
+}
+
+void ProfilerOverlay::Draw(const Profiler &profiler, SpriteBatch *batch)
+{
+    if(mFramesUntilLegend-- <= 0)
+    {
+        UpdateLegend(profiler);
+        mFramesUntilLegend = OVERLAY_LEGEND_INTERVAL;
+    }
+
+    SDL_SetRenderDrawBlendMode(mRenderer, SDL_BLENDMODE_BLEND);
+    SDL_SetRenderDrawColor(mRenderer, 0, 0, 0, 180);
+    SDL_Rect panel = {mX - 4, mY - 4, PROFILE_FRAMES * OVERLAY_BAR_WIDTH + 8,
+                      OVERLAY_GRAPH_HEIGHT + 14 + (PHASE_COUNT + 1) * (OVERLAY_TEXT_HEIGHT + 2)};
+    SDL_RenderFillRect(mRenderer, &panel);
+    batch->Touch(panel);
+
+    // One stacked bar per frame, oldest on the left, drawn as one
+    // SDL_RenderFillRects call per phase colour.
+    size_t frames = profiler.FrameCount();
+    int bottom = mY + OVERLAY_GRAPH_HEIGHT;
+    for(size_t age=0; age < frames; age++)
+    {
+        const ProfileFrame &frame = profiler.Frame(age);
+        int x = mX + (int)(PROFILE_FRAMES - 1 - age) * OVERLAY_BAR_WIDTH;
+        float stacked = 0.0f;
+        for(int i=0; i < PHASE_COUNT; i++)
+        {
+            int y0 = (int)(stacked * OVERLAY_PIXELS_PER_MS / 1000.0f);
+            stacked += frame.phases[i];
+            int y1 = std::min((int)(stacked * OVERLAY_PIXELS_PER_MS / 1000.0f), OVERLAY_GRAPH_HEIGHT);
+            mBars[i][age] = {x, bottom - y1, OVERLAY_BAR_WIDTH, std::max(y1 - y0, 0)};
+        }
+    }
+    for(int i=0; i < PHASE_COUNT; i++)
+    {
+        SDL_Color color = PHASE_COLORS[i];
+        SDL_SetRenderDrawColor(mRenderer, color.r, color.g, color.b, color.a);
+        SDL_RenderFillRects(mRenderer, mBars[i], (int)frames);
+
+        SDL_Rect swatch = {mX, bottom + 6 + (i + 1) * (OVERLAY_TEXT_HEIGHT + 2), 10, OVERLAY_TEXT_HEIGHT};
+        SDL_RenderFillRect(mRenderer, &swatch);
+    }
+
+    // Whole-frame time as a line over the stack, with 16.7 ms and 33.3 ms
+    // reference lines, so time outside any phase (vsync waits) shows up.
+    SDL_SetRenderDrawColor(mRenderer, 255, 255, 255, 255);
+    for(size_t age=0; age < frames; age++)
+    {
+        int x = mX + (int)(PROFILE_FRAMES - 1 - age) * OVERLAY_BAR_WIDTH;
+        int y = std::min((int)(profiler.Frame(age).duration * OVERLAY_PIXELS_PER_MS / 1000.0f), OVERLAY_GRAPH_HEIGHT);
+        SDL_RenderDrawLine(mRenderer, x, bottom - y, x + OVERLAY_BAR_WIDTH - 1, bottom - y);
+    }
+    SDL_SetRenderDrawColor(mRenderer, 255, 255, 255, 80);
+    for(float ms : {1000.0f / 60.0f, 1000.0f / 30.0f})
+    {
+        int y = bottom - (int)(ms * OVERLAY_PIXELS_PER_MS);
+        SDL_RenderDrawLine(mRenderer, mX, y, mX + PROFILE_FRAMES * OVERLAY_BAR_WIDTH, y);
+    }
+
+    mFrameLabel->Draw(batch);
+    for(int i=0; i < PHASE_COUNT; i++)
+    {
+        mPhaseLabels[i]->Draw(batch);
+    }
+}
@@ -0,0 +1,34 @@
+#ifndef PROFILER_OVERLAY_H
+#define PROFILER_OVERLAY_H
+
+#include <SDL2/SDL.h>
+#include "profiler.h"
+#include "text.h"
+
+// Frame-time graph of the profiler ring, stacked by phase, with a legend
+// showing each phase's average per frame over the last second, judged by
+// the frames' timestamps; the whole ring when it holds less than that.
+class ProfilerOverlay
+{
+    public:
+        // x, y is the top-left corner of the graph.
+        ProfilerOverlay(SDL_Renderer *renderer, const GlyphAtlas *glyphs, int x, int y);
+        ~ProfilerOverlay();
+
+        // The graph is drawn straight to the renderer and the legend is
+        // queued in batch, so call it after the scene has been flushed.
+        void Draw(const Profiler &profiler, SpriteBatch *batch);
+
+    private:
+        void UpdateLegend(const Profiler &profiler);
+
+        SDL_Renderer *mRenderer;
+        int mX;
+        int mY;
+        TextLabel *mFrameLabel;
+        TextLabel *mPhaseLabels[PHASE_COUNT];
+        SDL_Rect mBars[PHASE_COUNT][PROFILE_FRAMES];
+        int mFramesUntilLegend;
+};
+
+#endif
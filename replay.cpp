@@ -0,0 +1,291 @@
+#include "replay.h"
+#include <string.h>
+
+static const char REPLAY_MAGIC[4] = {'A', 'S', 'T', 'R'};
+
+// Magic, version, seed and tuning.
+#define REPLAY_TUNING_SIZE 40
+#define REPLAY_HEADER_SIZE (16 + REPLAY_TUNING_SIZE)
+
+static void putU32(uint8_t *out, uint32_t value)
+{
+    for(int i=0; i < 4; i++)
+    {
+        out[i] = (uint8_t)(value >> (8 * i));
+    }
+}
+
+static uint32_t getU32(const uint8_t *in)
+{
+    return in[0] | (in[1] << 8) | (in[2] << 16) | ((uint32_t)in[3] << 24);
+}
+
+static void packTuning(const Tuning &tuning, uint8_t *out)
+{
+    const float fields[9] = {
+        tuning.shipSpeed, tuning.shipThrust, tuning.shipDrag, tuning.shipRotationSpeed,
+        tuning.shipShootTime, tuning.shipRespawnTime, tuning.bulletSpeed,
+        tuning.newWaveTime, tuning.waveRadius,
+    };
+    for(int i=0; i < 9; i++)
+    {
+        uint32_t bits;
+        memcpy(&bits, &fields[i], 4);
+        putU32(out + 4 * i, bits);
+    }
+    putU32(out + 36, (uint32_t)tuning.lives);
+}
+
+static void unpackTuning(const uint8_t *in, Tuning &tuning)
+{
+    float *fields[9] = {
+        &tuning.shipSpeed, &tuning.shipThrust, &tuning.shipDrag, &tuning.shipRotationSpeed,
+        &tuning.shipShootTime, &tuning.shipRespawnTime, &tuning.bulletSpeed,
+        &tuning.newWaveTime, &tuning.waveRadius,
+    };
+    for(int i=0; i < 9; i++)
+    {
+        uint32_t bits = getU32(in + 4 * i);
+        memcpy(fields[i], &bits, 4);
+    }
+    tuning.lives = (int32_t)getU32(in + 36);
+}
+
+ReplayRecorder::ReplayRecorder()
+{
+    mFile = nullptr;
+    mLastTick = 0;
+}
+
+ReplayRecorder::~ReplayRecorder()
+{
+    if(mFile != nullptr)
+    {
+        Close(mLastTick);
+    }
+}
+
+bool ReplayRecorder::Open(const char *path, uint64_t seed, const Tuning &tuning)
+{
+    mFile = fopen(path, "wb");
+    if(mFile == nullptr)
+    {
+        fprintf(stderr, "Unable to open replay %s for writing\n", path);
+        return false;
+    }
+    mLastTick = 0;
+
+    uint8_t header[REPLAY_HEADER_SIZE];
+    memcpy(header, REPLAY_MAGIC, 4);
+    header[4] = REPLAY_VERSION & 0xff;
+    header[5] = REPLAY_VERSION >> 8;
+    header[6] = 0;
+    header[7] = 0;
+    for(int i=0; i < 8; i++)
+    {
+        header[8 + i] = (uint8_t)(seed >> (8 * i));
+    }
+    packTuning(tuning, header + 16);
+    fwrite(header, 1, sizeof(header), mFile);
+    return true;
+}
+
+void ReplayRecorder::Varint(uint32_t value)
+{
+    while(value >= 0x80)
+    {
+        fputc((int)((value & 0x7f) | 0x80), mFile);
+        value >>= 7;
+    }
+    fputc((int)value, mFile);
+}
+
+void ReplayRecorder::Header(uint8_t type, uint32_t tick)
+{
+    fputc(type, mFile);
+    Varint(tick - mLastTick);
+    mLastTick = tick;
+}
+
+void ReplayRecorder::Input(uint32_t tick, const InputEvent *events, size_t count)
+{
+    if(mFile == nullptr) return;
+    // A tick rarely carries more than a few events; split anything larger.
+    while(count > 0)
+    {
+        size_t n = count > 255 ? 255 : count;
+        Header(REPLAY_INPUT, tick);
+        fputc((int)n, mFile);
+        for(size_t i=0; i < n; i++)
+        {
+            fputc((events[i].action << 1) | (events[i].pressed ? 1 : 0), mFile);
+        }
+        events += n;
+        count -= n;
+    }
+}
+
+void ReplayRecorder::Checksum(uint32_t tick, uint32_t checksum)
+{
+    if(mFile == nullptr) return;
+    Header(REPLAY_CHECKSUM, tick);
+    for(int i=0; i < 4; i++)
+    {
+        fputc((int)((checksum >> (8 * i)) & 0xff), mFile);
+    }
+}
+
+void ReplayRecorder::Close(uint32_t tick)
+{
+    if(mFile == nullptr) return;
+    Header(REPLAY_END, tick);
+    fclose(mFile);
+    mFile = nullptr;
+}
+
+ReplayPlayer::ReplayPlayer()
+{
+    mCursor = 0;
+    mSeed = 0;
+    mTuning = TUNING_DEFAULTS;
+    mEndTick = 0;
+    mType = REPLAY_END;
+    mTick = 0;
+    mPending = false;
+}
+
+bool ReplayPlayer::Open(const char *path)
+{
+    FILE *file = fopen(path, "rb");
+    if(file == nullptr)
+    {
+        fprintf(stderr, "Unable to open replay %s\n", path);
+        return false;
+    }
+    uint8_t buffer[4096];
+    size_t n;
+    mData.clear();
+    while((n = fread(buffer, 1, sizeof(buffer), file)) > 0)
+    {
+        mData.insert(mData.end(), buffer, buffer + n);
+    }
+    fclose(file);
+
+    if(mData.size() < REPLAY_HEADER_SIZE || memcmp(mData.data(), REPLAY_MAGIC, 4) != 0)
+    {
+        fprintf(stderr, "%s is not a replay\n", path);
+        return false;
+    }
+    uint16_t version = mData[4] | (mData[5] << 8);
+    if(version != REPLAY_VERSION)
+    {
+        fprintf(stderr, "Replay %s has version %u, expected %u\n", path, version, REPLAY_VERSION);
+        return false;
+    }
+    mSeed = 0;
+    for(int i=0; i < 8; i++)
+    {
+        mSeed |= (uint64_t)mData[8 + i] << (8 * i);
+    }
+    unpackTuning(mData.data() + 16, mTuning);
+
+    // Find the end tick up front so callers know how long to run.
+    mCursor = REPLAY_HEADER_SIZE;
+    mTick = 0;
+    mEndTick = 0;
+    while(mCursor < mData.size())
+    {
+        uint8_t type = mData[mCursor++];
+        uint32_t delta;
+        if(!Varint(delta)) break;
+        mTick += delta;
+        if(type == REPLAY_END)
+        {
+            mEndTick = mTick;
+            break;
+        }
+        if(type == REPLAY_INPUT && mCursor < mData.size())
+        {
+            mCursor += 1 + mData[mCursor];
+        }
+        else if(type == REPLAY_CHECKSUM)
+        {
+            mCursor += 4;
+        }
+    }
+    if(mEndTick == 0)
+    {
+        // Truncated recording: play whatever made it to disk.
+        mEndTick = mTick + 1;
+    }
+
+    mCursor = REPLAY_HEADER_SIZE;
+    mTick = 0;
+    mPending = false;
+    return true;
+}
+
+bool ReplayPlayer::Varint(uint32_t &value)
+{
+    value = 0;
+    for(int shift=0; shift < 35 && mCursor < mData.size(); shift += 7)
+    {
+        uint8_t byte = mData[mCursor++];
+        value |= (uint32_t)(byte & 0x7f) << shift;
+        if((byte & 0x80) == 0) return true;
+    }
+    return false;
+}
+
+void ReplayPlayer::Advance()
+{
+    if(mPending || mCursor >= mData.size()) return;
+    mType = mData[mCursor++];
+    uint32_t delta;
+    if(!Varint(delta))
+    {
+        mCursor = mData.size();
+        return;
+    }
+    mTick += delta;
+    mPending = true;
+}
+
+void ReplayPlayer::Input(uint32_t tick, std::vector<InputEvent> &out)
+{
+    for(Advance(); mPending && mTick <= tick && mType == REPLAY_INPUT; Advance())
+    {
+        if(mCursor >= mData.size())
+        {
+            // Cut off before the count; nothing more to play.
+            mPending = false;
+            return;
+        }
+        size_t count = mData[mCursor++];
+        for(size_t i=0; i < count && mCursor < mData.size(); i++)
+        {
+            uint8_t packed = mData[mCursor++];
+            out.push_back({(uint8_t)(packed >> 1), (uint8_t)(packed & 1)});
+        }
+        mPending = false;
+    }
+}
+
+bool ReplayPlayer::Verify(uint32_t tick, uint32_t checksum)
+{
+    bool match = true;
+    for(Advance(); mPending && mTick <= tick && mType == REPLAY_CHECKSUM; Advance())
+    {
+        uint32_t recorded = 0;
+        for(int i=0; i < 4 && mCursor < mData.size(); i++)
+        {
+            recorded |= (uint32_t)mData[mCursor++] << (8 * i);
+        }
+        if(mTick == tick && recorded != checksum)
+        {
+            match = false;
+        }
+        mPending = false;
+    }
+    return match;
+}
@@ -0,0 +1,97 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+#include "simulation.h"
+#include "tuning.h"
+
+// Replay files hold the seed, the tuning and the input applied on each
+// tick, which is all a deterministic simulation needs to reproduce a run.
+// Layout:
+//
+//   "ASTR" u16 version u16 reserved u64 seed
+//   tuning: f32 x 9 in Tuning field order, i32 lives
+//   records: u8 type, varint ticks since the previous record, then
+//     REPLAY_INPUT:    u8 count, count x u8 (action << 1 | pressed)
+//     REPLAY_CHECKSUM: u32 state checksum after the tick
+//     REPLAY_END:      nothing; the tick is the total tick count
+//
+// All integers are little-endian.
+#define REPLAY_VERSION 7
+
+enum ReplayRecord {
+    REPLAY_END = 0,
+    REPLAY_INPUT = 1,
+    REPLAY_CHECKSUM = 2,
+};
+
+class ReplayRecorder
+{
+    public:
+        ReplayRecorder();
+        ~ReplayRecorder();
+
+        bool Open(const char *path, uint64_t seed, const Tuning &tuning);
+        void Input(uint32_t tick, const InputEvent *events, size_t count);
+        void Checksum(uint32_t tick, uint32_t checksum);
+        void Close(uint32_t tick);
+
+    private:
+        void Header(uint8_t type, uint32_t tick);
+        void Varint(uint32_t value);
+
+        FILE *mFile;
+        uint32_t mLastTick;
+};
+
+class ReplayPlayer
+{
+    public:
+        ReplayPlayer();
+
+        bool Open(const char *path);
+
+        uint64_t Seed() const
+        {
+            return mSeed;
+        }
+
+        const Tuning &GetTuning() const
+        {
+            return mTuning;
+        }
+
+        uint32_t EndTick() const
+        {
+            return mEndTick;
+        }
+
+        bool Finished(uint32_t tick) const
+        {
+            return tick >= mEndTick;
+        }
+
+        // Append the input recorded for tick to out. Ticks must be visited in order.
+        void Input(uint32_t tick, std::vector<InputEvent> &out);
+        // False when tick has a recorded checksum that differs from checksum.
+        bool Verify(uint32_t tick, uint32_t checksum);
+
+    private:
+        bool Varint(uint32_t &value);
+        void Advance();
+
+        std::vector<uint8_t> mData;
+        size_t mCursor;
+        uint64_t mSeed;
+        Tuning mTuning;
+        uint32_t mEndTick;
+
+        // The record under the cursor, decoded but not yet consumed.
+        uint8_t mType;
+        uint32_t mTick;
+        bool mPending;
+};
+
+#endif
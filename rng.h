@@ -0,0 +1,62 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <stdint.h>
+
+// PCG32 (pcg-random.org). Unlike rand() its sequence is the same on every
+// platform and its whole state fits in 16 bytes, so a seed fully describes
+// a run and the state can be saved and restored.
+class Rng
+{
+    public:
+        Rng()
+        {
+            Seed(0);
+        }
+
+        void Seed(uint64_t seed)
+        {
+            mState = 0;
+            mIncrement = (seed << 1) | 1;
+            Next();
+            mState += seed;
+            Next();
+        }
+
+        uint32_t Next()
+        {
+            uint64_t old = mState;
+            mState = old * 6364136223846793005ULL + mIncrement;
+            uint32_t shifted = (uint32_t)(((old >> 18) ^ old) >> 27);
+            uint32_t rotation = (uint32_t)(old >> 59);
+            return (shifted >> rotation) | (shifted << ((32 - rotation) & 31));
+        }
+
+        // Uniform-enough integer in [0, n) for gameplay, a drop-in for rand() % n.
+        int Range(int n)
+        {
+            return (int)(Next() % (uint32_t)n);
+        }
+
+        uint64_t State() const
+        {
+            return mState;
+        }
+
+        uint64_t Increment() const
+        {
+            return mIncrement;
+        }
+
+        void Restore(uint64_t state, uint64_t increment)
+        {
+            mState = state;
+            mIncrement = increment;
+        }
+
+    private:
+        uint64_t mState;
+        uint64_t mIncrement;
+};
+
+#endif
@@ -0,0 +1,238 @@
+#include "rollback.h"
+#include <algorithm>
+#include <chrono>
+#include <string.h>
+
+static double secondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// The presses and releases that turn one tick's held buttons into the
+// next's, in InputAction order.
+static void queueChanges(int player, InputBits before, InputBits after)
+{
+    InputBits changed = before ^ after;
+    for(int action=0; action <= INPUT_RESTART; action++)
+    {
+        if(changed & (1 << action))
+        {
+            queueInput({(uint8_t)action, (uint8_t)((after >> action) & 1), (uint8_t)player});
+        }
+    }
+}
+
+RollbackSession::RollbackSession()
+{
+    mLocal = 0;
+    mIn = nullptr;
+    mAcks = nullptr;
+    mStart = 0;
+    memset(mInputs, 0, sizeof(mInputs));
+    memset(mConfirmed, 0, sizeof(mConfirmed));
+    memset(mLast, 0, sizeof(mLast));
+    memset(&mStats, 0, sizeof(mStats));
+}
+
+void RollbackSession::Start(uint32_t localPlayers, LoopbackTransport *in, LoopbackTransport *acks)
+{
+    mLocal = localPlayers;
+    mIn = in;
+    mAcks = acks;
+    mStart = gTick;
+    for(SaveState &state : mStates)
+    {
+        state.Reserve();
+    }
+    memset(mInputs, 0, sizeof(mInputs));
+    memset(mLast, 0, sizeof(mLast));
+    for(int p=0; p < MAX_SHIPS; p++)
+    {
+        mConfirmed[p] = gTick;
+    }
+}
+
+void RollbackSession::Run(uint32_t tick)
+{
+    mStates[tick % ROLLBACK_WINDOW].Capture();
+    const InputBits *inputs = mInputs[tick % INPUT_SLOTS];
+    for(int p=0; p < gShipCount; p++)
+    {
+        InputBits before = tick > mStart ? mInputs[(tick - 1) % INPUT_SLOTS][p] : 0;
+        queueChanges(p, before, inputs[p]);
+    }
+    ::tick();
+}
+
+void RollbackSession::Poll(double now)
+{
+    uint32_t current = gTick;
+    uint32_t rewind = current;
+
+    NetPacket packet;
+    while(mIn != nullptr && mIn->Receive(packet, now))
+    {
+        int p = packet.player;
+        if(packet.type != NET_INPUT || p >= gShipCount || (mLocal & (1u << p))) continue;
+
+        // Only the next tick missing is taken; anything after a gap, or not
+        // yet run here, is sent again until acknowledged.
+        for(int k=0; k < packet.count; k++)
+        {
+            uint32_t tick = packet.tick + k;
+            if(tick < mConfirmed[p]) continue;
+            if(tick > mConfirmed[p] || tick >= current) break;
+
+            InputBits &used = mInputs[tick % INPUT_SLOTS][p];
+            if(used != packet.inputs[k]) rewind = std::min(rewind, tick);
+            used = packet.inputs[k];
+            mLast[p] = packet.inputs[k];
+            mConfirmed[p]++;
+        }
+    }
+
+    // Ticks still predicted now predict the newest real input.
+    for(int p=0; p < gShipCount; p++)
+    {
+        if(mLocal & (1u << p)) continue;
+        for(uint32_t tick=mConfirmed[p]; tick < current; tick++)
+        {
+            InputBits &used = mInputs[tick % INPUT_SLOTS][p];
+            if(used != mLast[p]) rewind = std::min(rewind, tick);
+            used = mLast[p];
+        }
+        if(mAcks != nullptr)
+        {
+            NetPacket ack = {};
+            ack.type = NET_ACK;
+            ack.player = (uint8_t)p;
+            ack.tick = mConfirmed[p];
+            mAcks->Send(ack, now);
+        }
+    }
+
+    if(rewind < current)
+    {
+        auto start = std::chrono::steady_clock::now();
+        SoundQueue *sounds = gSoundQueue;
+        EffectQueue *effects = gEffectQueue;
+        gSoundQueue = nullptr;
+        gEffectQueue = nullptr;
+
+        mStates[rewind % ROLLBACK_WINDOW].Restore();
+        for(uint32_t tick=rewind; tick < current; tick++)
+        {
+            Run(tick);
+        }
+
+        gSoundQueue = sounds;
+        gEffectQueue = effects;
+        mStats.rollbacks++;
+        mStats.resimulated += current - rewind;
+        mStats.deepest = std::max(mStats.deepest, current - rewind);
+        mStats.resimulateSeconds += secondsSince(start);
+    }
+}
+
+bool RollbackSession::Advance(const InputBits *local, double now)
+{
+    Poll(now);
+
+    uint32_t current = gTick;
+    for(int p=0; p < gShipCount; p++)
+    {
+        // Running on would overwrite the state the oldest missing tick
+        // needs to rewind to.
+        if(!(mLocal & (1u << p)) && mConfirmed[p] + ROLLBACK_WINDOW <= current)
+        {
+            mStats.stalls++;
+            return false;
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    InputBits *inputs = mInputs[current % INPUT_SLOTS];
+    for(int p=0; p < gShipCount; p++)
+    {
+        if(mLocal & (1u << p))
+        {
+            inputs[p] = local[p];
+            mLast[p] = local[p];
+            mConfirmed[p] = current + 1;
+        }
+        else
+        {
+            inputs[p] = mLast[p];
+        }
+    }
+    Run(current);
+    mStats.ticks++;
+    mStats.simulateSeconds += secondsSince(start);
+    return true;
+}
+
+bool RollbackSession::Confirmed() const
+{
+    for(int p=0; p < gShipCount; p++)
+    {
+        if(mConfirmed[p] < gTick) return false;
+    }
+    return true;
+}
+
+InputSender::InputSender()
+{
+    mPlayers = 0;
+    mNext = 0;
+    memset(mAcked, 0, sizeof(mAcked));
+    memset(mHistory, 0, sizeof(mHistory));
+}
+
+void InputSender::Start(uint32_t players, uint32_t tick)
+{
+    mPlayers = players;
+    mNext = tick;
+    for(int p=0; p < MAX_SHIPS; p++)
+    {
+        mAcked[p] = tick;
+    }
+}
+
+void InputSender::Record(uint32_t tick, const InputBits *inputs)
+{
+    if(tick != mNext) return;
+    memcpy(mHistory[tick % HISTORY], inputs, sizeof(mHistory[0]));
+    mNext++;
+}
+
+void InputSender::Flush(LoopbackTransport *out, LoopbackTransport *acks, double now)
+{
+    NetPacket packet;
+    while(acks->Receive(packet, now))
+    {
+        if(packet.type == NET_ACK && packet.player < MAX_SHIPS)
+        {
+            mAcked[packet.player] = std::max(mAcked[packet.player], packet.tick);
+        }
+    }
+
+    for(int p=0; p < gShipCount; p++)
+    {
+        if(!(mPlayers & (1u << p))) continue;
+        // Older ticks than the history holds were confirmed by the
+        // receiver before it let this peer record any newer.
+        uint32_t first = std::max(mAcked[p], mNext > HISTORY ? mNext - HISTORY : 0);
+        if(first >= mNext) continue;
+
+        packet = {};
+        packet.type = NET_INPUT;
+        packet.player = (uint8_t)p;
+        packet.tick = first;
+        packet.count = (uint8_t)std::min(mNext - first, (uint32_t)ROLLBACK_WINDOW);
+        for(int k=0; k < packet.count; k++)
+        {
+            packet.inputs[k] = mHistory[(first + k) % HISTORY][p];
+        }
+        out->Send(packet, now);
+    }
+}
@@ -0,0 +1,105 @@
+#ifndef ROLLBACK_H
+#define ROLLBACK_H
+
+#include <stdint.h>
+#include "simulation.h"
+#include "savestate.h"
+#include "loopback.h"
+
+// What prediction cost so far. resimulated counts ticks run again after a
+// misprediction, deepest the most ticks one rollback rewound, and stalls
+// the Advance calls refused because remote input fell a whole window
+// behind. The times are spent in first runs and in rewinding and running
+// again; saving the state each tick counts towards the first.
+struct RollbackStats {
+    uint64_t ticks;
+    uint64_t resimulated;
+    uint64_t rollbacks;
+    uint32_t deepest;
+    uint64_t stalls;
+    double simulateSeconds;
+    double resimulateSeconds;
+};
+
+// Runs the simulation ahead of remote players: a tick never waits for
+// their input, it predicts they hold what they last sent. When the real
+// input arrives and differs, the session restores the state saved before
+// the first wrong tick and runs every tick since again. Only the last
+// ROLLBACK_WINDOW ticks can be rewound; a remote player further behind
+// stalls the session until their input arrives. Resimulated ticks emit no
+// sounds or effects, since they were already played.
+class RollbackSession
+{
+    public:
+        RollbackSession();
+
+        // localPlayers is a mask of the players whose input Advance is
+        // given; the others arrive on in, and acknowledgements go out on
+        // acks. Call after initSimulation, between ticks.
+        void Start(uint32_t localPlayers, LoopbackTransport *in, LoopbackTransport *acks);
+        // Take arrived input, then run the next tick. local holds an entry
+        // per ship; remote players' entries are ignored. False, with no tick
+        // run, while stalled.
+        bool Advance(const InputBits *local, double now);
+        // Take arrived input and correct mispredicted ticks without running
+        // a new one.
+        void Poll(double now);
+        // Every tick so far ran on real input.
+        bool Confirmed() const;
+
+        const RollbackStats &Stats() const
+        {
+            return mStats;
+        }
+
+    private:
+        void Run(uint32_t tick);
+
+        uint32_t mLocal;
+        LoopbackTransport *mIn;
+        LoopbackTransport *mAcks;
+        uint32_t mStart;
+
+        // The state before each of the last ROLLBACK_WINDOW ticks, indexed
+        // by tick % ROLLBACK_WINDOW, and the input each ran with, real or
+        // predicted. The input ring holds one tick more: the oldest tick
+        // rewound to needs the input before it to turn into presses.
+        static const int INPUT_SLOTS = ROLLBACK_WINDOW + 1;
+        SaveState mStates[ROLLBACK_WINDOW];
+        InputBits mInputs[INPUT_SLOTS][MAX_SHIPS];
+        // Each player's input is real for ticks before mConfirmed, and
+        // mLast is the newest real input, which later ticks predict.
+        uint32_t mConfirmed[MAX_SHIPS];
+        InputBits mLast[MAX_SHIPS];
+
+        RollbackStats mStats;
+};
+
+// Stands in for a remote peer on the other end of a loopback link: it
+// keeps its players' recent input and resends the oldest ticks not yet
+// acknowledged, a packet's worth per player, on every Flush.
+class InputSender
+{
+    public:
+        InputSender();
+
+        // players is a mask of the players this peer owns. tick is the first
+        // tick it will record.
+        void Start(uint32_t players, uint32_t tick);
+        // inputs holds an entry per ship. Each tick is recorded once; repeats
+        // while the receiver is stalled are ignored.
+        void Record(uint32_t tick, const InputBits *inputs);
+        void Flush(LoopbackTransport *out, LoopbackTransport *acks, double now);
+
+    private:
+        // A stalled receiver can still miss the tick a whole window before
+        // the one it is stuck on, which this peer has already recorded.
+        static const int HISTORY = ROLLBACK_WINDOW + 1;
+
+        uint32_t mPlayers;
+        uint32_t mNext;
+        uint32_t mAcked[MAX_SHIPS];
+        InputBits mHistory[HISTORY][MAX_SHIPS];
+};
+
+#endif
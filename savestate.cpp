@@ -0,0 +1,210 @@
+#include "savestate.h"
+#include <stdio.h>
+#include <string.h>
+
+static const char SAVESTATE_MAGIC[4] = {'A', 'S', 'T', 'S'};
+
+// Layout up to and including the entity counts.
+#define SAVESTATE_HEADER_SIZE(ships) (8 + 4 + 8 + 8 + 12 + 4 + 8 + sizeof(Tuning) + 4 + (ships) * sizeof(ShipState) + 8)
+#define SAVESTATE_ASTEROID_SIZE (6 * sizeof(float) + 1)
+#define SAVESTATE_BULLET_SIZE (5 * sizeof(float))
+
+// Reads the layout front to back; every Get is bounds checked by the
+// caller's size test up front.
+struct Reader {
+    const uint8_t *p;
+
+    template<typename T>
+    T Get()
+    {
+        T value;
+        memcpy(&value, p, sizeof(T));
+        p += sizeof(T);
+        return value;
+    }
+
+    const uint8_t *Skip(size_t size)
+    {
+        const uint8_t *start = p;
+        p += size;
+        return start;
+    }
+};
+
+SaveState::SaveState()
+{
+}
+
+void SaveState::Reserve()
+{
+    mData.reserve(SAVESTATE_HEADER_SIZE(MAX_SHIPS) + gAsteroids.stats.capacity * SAVESTATE_ASTEROID_SIZE +
+                  gBullets.stats.capacity * SAVESTATE_BULLET_SIZE);
+}
+
+void SaveState::Put(const void *data, size_t size)
+{
+    const uint8_t *bytes = (const uint8_t*)data;
+    mData.insert(mData.end(), bytes, bytes + size);
+}
+
+void SaveState::Capture()
+{
+    mData.clear();
+
+    uint16_t version[2] = {SAVESTATE_VERSION, 0};
+    Put(SAVESTATE_MAGIC, 4);
+    Put(version, sizeof(version));
+
+    uint64_t rng[2] = {gRng.State(), gRng.Increment()};
+    Put(&gTick, sizeof(gTick));
+    Put(rng, sizeof(rng));
+
+    int32_t counters[3] = {gLives, gScore, gWave};
+    uint8_t flags[4] = {gIsGameStarted, gIsWaveEnd, gGameOver, 0};
+    float timers[2] = {gNewWaveTimer, gAsteroidMaxStep};
+    Put(counters, sizeof(counters));
+    Put(flags, sizeof(flags));
+    Put(timers, sizeof(timers));
+    Put(&gTuning, sizeof(gTuning));
+
+    uint32_t ships = (uint32_t)gShipCount;
+    Put(&ships, sizeof(ships));
+    for(int s=0; s < gShipCount; s++)
+    {
+        ShipState ship = gShips[s]->Save();
+        Put(&ship, sizeof(ship));
+    }
+
+    uint32_t counts[2] = {(uint32_t)gAsteroids.Size(), (uint32_t)gBullets.Size()};
+    Put(counts, sizeof(counts));
+
+    PutArray(gAsteroids.x);
+    PutArray(gAsteroids.y);
+    PutArray(gAsteroids.vx);
+    PutArray(gAsteroids.vy);
+    PutArray(gAsteroids.angle);
+    PutArray(gAsteroids.rotationSpeed);
+    for(AsteroidType type : gAsteroids.type)
+    {
+        mData.push_back((uint8_t)type);
+    }
+
+    PutArray(gBullets.x);
+    PutArray(gBullets.y);
+    PutArray(gBullets.vx);
+    PutArray(gBullets.vy);
+    PutArray(gBullets.angle);
+}
+
+bool SaveState::Restore() const
+{
+    if(mData.size() < SAVESTATE_HEADER_SIZE(0) || memcmp(mData.data(), SAVESTATE_MAGIC, 4) != 0) return false;
+
+    Reader reader = {mData.data() + 4};
+    if(reader.Get<uint16_t>() != SAVESTATE_VERSION) return false;
+    reader.Skip(2);
+
+    uint32_t tick = reader.Get<uint32_t>();
+    uint64_t rngState = reader.Get<uint64_t>();
+    uint64_t rngIncrement = reader.Get<uint64_t>();
+    int32_t lives = reader.Get<int32_t>();
+    int32_t score = reader.Get<int32_t>();
+    int32_t wave = reader.Get<int32_t>();
+    const uint8_t *flags = reader.Skip(4);
+    float newWaveTimer = reader.Get<float>();
+    float maxStep = reader.Get<float>();
+    Tuning tuning = reader.Get<Tuning>();
+    uint32_t ships = reader.Get<uint32_t>();
+    if(ships != (uint32_t)gShipCount || mData.size() < SAVESTATE_HEADER_SIZE(ships)) return false;
+    const uint8_t *shipBlock = reader.Skip(ships * sizeof(ShipState));
+    size_t asteroids = reader.Get<uint32_t>();
+    size_t bullets = reader.Get<uint32_t>();
+
+    if(asteroids > gAsteroids.stats.capacity || bullets > gBullets.stats.capacity) return false;
+    if(mData.size() != SAVESTATE_HEADER_SIZE(ships) + asteroids * SAVESTATE_ASTEROID_SIZE + bullets * SAVESTATE_BULLET_SIZE) return false;
+
+    const uint8_t *asteroidBlock = reader.Skip(asteroids * SAVESTATE_ASTEROID_SIZE);
+    const uint8_t *types = asteroidBlock + asteroids * 6 * sizeof(float);
+    const uint8_t *bulletBlock = reader.Skip(bullets * SAVESTATE_BULLET_SIZE);
+    for(size_t i=0; i < asteroids; i++)
+    {
+        if(types[i] >= ASTEROID_TYPES) return false;
+    }
+
+    // Everything checked; nothing below can fail.
+    gTick = tick;
+    gRng.Restore(rngState, rngIncrement);
+    gLives = lives;
+    gScore = score;
+    gWave = wave;
+    gIsGameStarted = flags[0] != 0;
+    gIsWaveEnd = flags[1] != 0;
+    gGameOver = flags[2] != 0;
+    gNewWaveTimer = newWaveTimer;
+    gAsteroidMaxStep = maxStep;
+    gTuning = tuning;
+    for(uint32_t s=0; s < ships; s++)
+    {
+        ShipState ship;
+        memcpy(&ship, shipBlock + s * sizeof(ShipState), sizeof(ShipState));
+        gShips[s]->Load(ship);
+    }
+
+    // Add rebuilds the handle tables as it goes; the arrays are unaligned
+    // in the buffer, so each field is read with memcpy.
+    gAsteroids.Clear();
+    for(size_t i=0; i < asteroids; i++)
+    {
+        float fields[6];
+        for(int f=0; f < 6; f++)
+        {
+            memcpy(&fields[f], asteroidBlock + (f * asteroids + i) * sizeof(float), sizeof(float));
+        }
+        AsteroidType type = (AsteroidType)types[i];
+        Size size = gAsteroidSizes[type];
+        gAsteroids.Add(Vector2(fields[0], fields[1]), Vector2(fields[2], fields[3]), fields[4], fields[5], size.w, size.h, type);
+    }
+
+    gBullets.Clear();
+    for(size_t i=0; i < bullets; i++)
+    {
+        float fields[5];
+        for(int f=0; f < 5; f++)
+        {
+            memcpy(&fields[f], bulletBlock + (f * bullets + i) * sizeof(float), sizeof(float));
+        }
+        gBullets.Add(Vector2(fields[0], fields[1]), Vector2(fields[2], fields[3]), fields[4], gBulletSize.w, gBulletSize.h);
+    }
+    return true;
+}
+
+bool SaveState::Write(const char *path) const
+{
+    FILE *file = fopen(path, "wb");
+    if(file == nullptr)
+    {
+        fprintf(stderr, "Unable to open save state %s for writing\n", path);
+        return false;
+    }
+    bool written = fwrite(mData.data(), 1, mData.size(), file) == mData.size();
+    fclose(file);
+    return written;
+}
+
+bool SaveState::Read(const char *path)
+{
+    FILE *file = fopen(path, "rb");
+    if(file == nullptr)
+    {
+        fprintf(stderr, "Unable to open save state %s\n", path);
+        return false;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    mData.resize(size > 0 ? (size_t)size : 0);
+    bool read = fread(mData.data(), 1, mData.size(), file) == mData.size();
+    fclose(file);
+    if(!read) mData.clear();
+    return read;
+}
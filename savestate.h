@@ -0,0 +1,67 @@
+#ifndef SAVESTATE_H
+#define SAVESTATE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include "simulation.h"
+#include "tuning.h"
+
+// A copy of the whole simulation between two ticks, for quick retry and for
+// debugging from a known state. Layout:
+//
+//   "ASTS" u16 version u16 reserved
+//   u32 tick, u64 rng state, u64 rng increment
+//   i32 lives, score, wave, u8 started, wave end, game over, u8 reserved
+//   f32 new wave timer, f32 asteroid max step
+//   Tuning
+//   u32 ship count s, ShipState[s]
+//   u32 asteroid count n, u32 bullet count m
+//   asteroids: f32[n] x, y, vx, vy, angle, rotation speed, u8[n] type
+//   bullets:   f32[m] x, y, vx, vy, angle
+//
+// Asteroid and bullet sizes follow from their types and are not stored.
+// The arrays are copied as they sit in memory, in host byte order, so a
+// state is for the build and machine that wrote it, unlike a replay.
+#define SAVESTATE_VERSION 3
+
+class SaveState
+{
+    public:
+        SaveState();
+
+        // Sizes the buffer for full pools, so neither Capture nor Restore
+        // allocates. Call after initSimulation.
+        void Reserve();
+
+        void Capture();
+        // False, with the simulation untouched, when there is nothing to
+        // restore or the state does not fit this build, the pools or the
+        // number of ships.
+        bool Restore() const;
+
+        bool Write(const char *path) const;
+        bool Read(const char *path);
+
+        bool Empty() const
+        {
+            return mData.empty();
+        }
+
+        size_t Bytes() const
+        {
+            return mData.size();
+        }
+
+    private:
+        void Put(const void *data, size_t size);
+        template<typename T>
+        void PutArray(const std::vector<T> &values)
+        {
+            Put(values.data(), values.size() * sizeof(T));
+        }
+
+        std::vector<uint8_t> mData;
+};
+
+#endif
@@ -0,0 +1,886 @@
+#include "simulation.h"
+#include "integrate.h"
+#include "replay.h"
+#include "profiler.h"
+#include "jobs.h"
+#include <stdio.h>
+#include <string.h>
+#include <new>
+#include <algorithm>
+
+#define COLLISION_CELL_SIZE 64
+
+void applyInput(InputEvent event);
+
+// Zero until set by the renderer or defaulted from the archetypes.
+Size gAsteroidSizes[ASTEROID_TYPES];
+Size gBulletSize = {9/2, 37/2};
+Size gShipSize = {99/2, 75/2};
+
+Hull gAsteroidHulls[ASTEROID_TYPES];
+Hull gBulletHull;
+Hull gShipHull;
+
+// Asteroid circle radii, and how far the largest circle pokes out of its
+// asteroid's rectangle. Grid queries grow by the latter, since the grid
+// files asteroids by rectangle.
+float gAsteroidRadii[ASTEROID_TYPES];
+float gAsteroidReach = 0.0f;
+// Fastest any asteroid has moved per tick on either axis, so swept queries
+// can allow for asteroids coming to meet them.
+float gAsteroidMaxStep = 0.0f;
+
+Bullets gBullets;
+Asteroids gAsteroids;
+int gShipCount = 1;
+Ship *gShips[MAX_SHIPS];
+// The ships live here rather than on the heap so a restart doesn't allocate.
+alignas(Ship) static unsigned char sShipStorage[MAX_SHIPS][sizeof(Ship)];
+
+SpatialHash gAsteroidGrid(WIDTH, HEIGHT, COLLISION_CELL_SIZE);
+GhostList gAsteroidGhosts;
+std::vector<uint32_t> gCollisionCandidates;
+std::vector<InputEvent> gInputQueue;
+
+// Per-worker broadphase results and stamps, indexed by WorkerIndex(), and
+// the per-bullet outcome of the parallel collision pass: the first asteroid
+// each bullet touches along its path (-1 for none), when, and whether it
+// touches more than one. gBulletOrder is a min-heap of the bullets whose
+// hits are still to settle, earliest on top.
+std::vector<uint32_t> gWorkerCandidates[MAX_JOB_THREADS];
+QueryStamps gWorkerStamps[MAX_JOB_THREADS];
+std::vector<int32_t> gBulletFirstHit;
+std::vector<float> gBulletHitTime;
+std::vector<uint8_t> gBulletMoreHits;
+std::vector<uint32_t> gBulletOrder;
+
+// Scratch for --check-collisions, sized once by initSimulation.
+static std::vector<uint8_t> sExpectedBullets, sExpectedAsteroids, sInitialBullets, sInitialAsteroids;
+
+#define BULLET_CULL_MARGIN 128
+// Smallest slice of work worth handing to another thread.
+#define INTEGRATE_GRAIN 4096
+#define COLLIDE_GRAIN 256
+
+Rng gRng;
+uint32_t gTick = 0;
+ReplayRecorder *gRecorder = nullptr;
+ReplayPlayer *gPlayer = nullptr;
+uint32_t gDesyncTick = NO_DESYNC;
+
+SoundQueue *gSoundQueue = nullptr;
+EffectQueue *gEffectQueue = nullptr;
+// Bit per SoundId already emitted this tick.
+static uint32_t sTickSounds = 0;
+
+// Set with --check-collisions: every tick the grid results are compared
+// against the brute-force scan and mismatches are logged.
+bool gCheckCollisions = false;
+
+size_t gStressAsteroids = 0;
+size_t gStressBullets = 0;
+// Room for each big asteroid to split once before the pool refuses more.
+#define STRESS_SPLIT_ROOM 2
+// Ticks a stress bullet can live: from the centre past the corner plus the
+// cull margin at BULLET_SPEED.
+#define STRESS_BULLET_TICKS 64
+// Keeps the spiral off the ship's spawn point.
+#define STRESS_CLEAR_RADIUS 200.0f
+#define STRESS_GOLDEN_ANGLE 2.39996323f
+// Degrees the bullet fan turns each tick.
+#define STRESS_FAN_STEP 7.0f
+
+float gStartGameTime = 5000.0f;
+float gStartGameTimer = 0.0f;
+
+float gNewWaveTimer = 0.0f;
+
+int gLives = 2;
+int gScore = 0;
+int gWave = 0;
+
+bool gIsGameStarted = false;
+bool gIsWaveEnd = true;
+bool gGameOver = false;
+
+bool collide(IntRect a, IntRect b)
+{
+
+	float aLeft = a.x;
+	float aRight = a.x + a.w;
+	float aTop = a.y;
+	float aBottom = a.y + a.h;
+
+	float bLeft = b.x;
+	float bRight = b.x + b.w;
+	float bTop = b.y;
+	float bBottom = b.y + b.h;
+
+	if (aLeft >= bRight)
+	{
+		return false;
+	}
+
+	if (aRight <= bLeft)
+	{
+		return false;
+	}
+
+	if (aTop >= bBottom)
+	{
+		return false;
+	}
+
+	if (aBottom <= bTop)
+	{
+		return false;
+	}
+
+    return true;
+}
+
+void emitSound(SoundId sound)
+{
+    uint32_t bit = 1u << sound;
+    if(sTickSounds & bit) return;
+    sTickSounds |= bit;
+    // A full queue means nobody is draining it; the sound is dropped.
+    if(gSoundQueue != nullptr) gSoundQueue->Push(sound);
+}
+
+void emitEffect(EffectKind kind, float x, float y, float vx, float vy, float angle)
+{
+    // A full queue means the renderer is behind; the effect is dropped.
+    if(gEffectQueue != nullptr) gEffectQueue->Push({kind, x, y, vx, vy, angle});
+}
+
+// Draws x before y. Two calls in one argument list would leave the order
+// up to the compiler and with it the replay.
+static Vector2 randomVelocity(float scale)
+{
+    float x = gRng.Range(10) * scale;
+    float y = gRng.Range(10) * scale;
+    return Vector2(x, y);
+}
+
+static inline ptrdiff_t spawnArchetype(Vector2 pos, AsteroidType type, const AsteroidArchetype &archetype)
+{
+    float rotationSpeed = gRng.Range(10) * archetype.spin;
+    Vector2 velocity = randomVelocity(archetype.speed);
+    float angle = gRng.Range(360);
+    gAsteroidMaxStep = std::max(gAsteroidMaxStep, std::max(fabsf(velocity.x), fabsf(velocity.y)));
+    Size size = gAsteroidSizes[type];
+    EntityHandle handle = gAsteroids.Add(pos, velocity, angle, rotationSpeed, size.w, size.h, type);
+    return gAsteroids.handles.Lookup(handle);
+}
+
+// For spawns whose type is known where they are written; the archetype's
+// constants fold into the call.
+template<AsteroidType T>
+static ptrdiff_t spawnAsteroid(Vector2 pos)
+{
+    return spawnArchetype(pos, T, archetype<T>());
+}
+
+ptrdiff_t spawnAsteroid(Vector2 pos, AsteroidType type)
+{
+    return spawnArchetype(pos, type, ASTEROID_ARCHETYPES[type]);
+}
+
+void splitAsteroid(Vector2 pos, AsteroidType type)
+{
+    const AsteroidArchetype &parent = ASTEROID_ARCHETYPES[type];
+    for(int k=0; k < parent.splitCount; k++)
+    {
+        // The fragment's own velocity is drawn before it spawns, so this
+        // keeps the order the replays depend on.
+        Vector2 velocity = randomVelocity(k % 2 ? -parent.splitSpeed : parent.splitSpeed);
+        ptrdiff_t fragment = spawnAsteroid(pos, parent.splitInto);
+        if(fragment >= 0)
+        {
+            gAsteroids.vx[fragment] = velocity.x;
+            gAsteroids.vy[fragment] = velocity.y;
+            gAsteroidMaxStep = std::max(gAsteroidMaxStep, std::max(fabsf(velocity.x), fabsf(velocity.y)));
+        }
+    }
+}
+
+// Integration is per element, so splitting it across workers gives the
+// same bits as one pass.
+void updateAsteroids()
+{
+    gJobs.ParallelFor(gAsteroids.Size(), INTEGRATE_GRAIN, [](size_t begin, size_t end) {
+        IntegrateAsteroids(gAsteroids.x.data() + begin, gAsteroids.y.data() + begin, gAsteroids.angle.data() + begin,
+                           gAsteroids.vx.data() + begin, gAsteroids.vy.data() + begin, gAsteroids.rotationSpeed.data() + begin,
+                           end - begin, WIDTH, HEIGHT);
+    });
+}
+
+void updateBullets()
+{
+    gJobs.ParallelFor(gBullets.Size(), INTEGRATE_GRAIN, [](size_t begin, size_t end) {
+        IntegrateBullets(gBullets.x.data() + begin, gBullets.y.data() + begin,
+                         gBullets.vx.data() + begin, gBullets.vy.data() + begin, end - begin);
+    });
+
+    // Bullets fly in a straight line and neither asteroids nor their ghosts
+    // hang further off screen than their own size, so one this far off
+    // screen can't hit anything.
+    for(size_t i=0; i < gBullets.Size(); i++)
+    {
+        if(gBullets.x[i] < -BULLET_CULL_MARGIN || gBullets.x[i] > WIDTH + BULLET_CULL_MARGIN ||
+           gBullets.y[i] < -BULLET_CULL_MARGIN || gBullets.y[i] > HEIGHT + BULLET_CULL_MARGIN)
+        {
+            gBullets.destroyed[i] = 1;
+        }
+    }
+}
+
+// A ship or bullet ready for the narrowphase: its hull in world space, a
+// circle around its centre that holds it at any rotation, how far it moved
+// this tick, and the seams it crosses. Bullets don't wrap, so they cross
+// none.
+struct Collider {
+    Polygon polygon;
+    float x;
+    float y;
+    float radius;
+    float dx;
+    float dy;
+    uint8_t seams;
+};
+
+static void bulletCollider(size_t i, Collider &collider)
+{
+    collider.x = gBullets.x[i] + gBullets.width[i] * 0.5f;
+    collider.y = gBullets.y[i] + gBullets.height[i] * 0.5f;
+    collider.radius = gBulletHull.radius;
+    collider.dx = gBullets.vx[i];
+    collider.dy = gBullets.vy[i];
+    collider.seams = 0;
+    // Sprites point up, so they are drawn turned by angle - 90.
+    TransformHull(gBulletHull, collider.x, collider.y, gBullets.angle[i] - 90, collider.polygon);
+}
+
+static void shipCollider(const Ship &ship, Collider &collider)
+{
+    collider.x = ship.Pos().x + ship.Width() * 0.5f;
+    collider.y = ship.Pos().y + ship.Height() * 0.5f;
+    collider.radius = gShipHull.radius;
+    collider.dx = ship.Velocity().x;
+    collider.dy = ship.Velocity().y;
+    collider.seams = BoxSeams(ship.Pos().x, ship.Pos().y, ship.Width(), ship.Height(), WIDTH, HEIGHT);
+    TransformHull(gShipHull, collider.x, collider.y, ship.Angle() - 90, collider.polygon);
+}
+
+// Every asteroid whose circle may touch the collider during the tick: the
+// box around its path, grown by how far an asteroid can move to meet it.
+static void queryCollider(const Collider &collider, std::vector<uint32_t> &out, bool concurrent)
+{
+    float extent = collider.radius + gAsteroidReach + gAsteroidMaxStep;
+    int x = (int)floorf(std::min(collider.x, collider.x - collider.dx) - extent);
+    int y = (int)floorf(std::min(collider.y, collider.y - collider.dy) - extent);
+    int w = (int)ceilf(fabsf(collider.dx) + extent * 2) + 1;
+    int h = (int)ceilf(fabsf(collider.dy) + extent * 2) + 1;
+    if(concurrent)
+    {
+        gAsteroidGrid.QueryConcurrent(x, y, w, h, gWorkerStamps[JobSystem::WorkerIndex()], out);
+    }
+    else
+    {
+        gAsteroidGrid.Query(x, y, w, h, out);
+    }
+}
+
+// Whether the collider touched asteroid j, centred at (x, y), at any point
+// during the tick, and the fraction of the tick at which it first did.
+// Motion comes from the velocities, so a wrap doesn't read as a jump across
+// the playfield.
+static bool sweepAsteroid(const Collider &collider, size_t j, float x, float y, float &time)
+{
+    float radius = gAsteroidRadii[gAsteroids.type[j]];
+    // Seen from the collider, the asteroid moves by the difference of the
+    // two velocities and ends where it is now.
+    float dx = gAsteroids.vx[j] - collider.dx;
+    float dy = gAsteroids.vy[j] - collider.dy;
+    float startX = x - dx;
+    float startY = y - dy;
+    // Box reject first; most grid candidates fail it and it skips the sweep.
+    float reach = radius + collider.radius;
+    if(std::min(x, startX) > collider.x + reach || std::max(x, startX) < collider.x - reach) return false;
+    if(std::min(y, startY) > collider.y + reach || std::max(y, startY) < collider.y - reach) return false;
+    return SweepCircleAgainstPolygon(startX, startY, radius, dx, dy, collider.polygon, time);
+}
+
+// sweepAsteroid against every copy of asteroid j the collider can meet:
+// its ghosts one playfield back when the asteroid crosses a seam, or
+// copies one playfield on when the collider does. The earliest hit counts.
+static bool hitsAsteroid(const Collider &collider, size_t j, float &time)
+{
+    float x = gAsteroids.x[j] + gAsteroids.width[j] * 0.5f;
+    float y = gAsteroids.y[j] + gAsteroids.height[j] * 0.5f;
+    bool hit = sweepAsteroid(collider, j, x, y, time);
+
+    uint8_t seams = gAsteroidGhosts.Seams()[j];
+    if((seams | collider.seams) == 0) return hit;
+    float shiftX = (seams & WRAP_SEAM_X) ? -WIDTH : (collider.seams & WRAP_SEAM_X) ? WIDTH : 0.0f;
+    float shiftY = (seams & WRAP_SEAM_Y) ? -HEIGHT : (collider.seams & WRAP_SEAM_Y) ? HEIGHT : 0.0f;
+    const float copies[3][2] = {{shiftX, 0.0f}, {0.0f, shiftY}, {shiftX, shiftY}};
+    const bool exists[3] = {shiftX != 0.0f, shiftY != 0.0f, shiftX != 0.0f && shiftY != 0.0f};
+    for(int c=0; c < 3; c++)
+    {
+        float t;
+        if(exists[c] && sweepAsteroid(collider, j, x + copies[c][0], y + copies[c][1], t) && (!hit || t < time))
+        {
+            hit = true;
+            time = t;
+        }
+    }
+    return hit;
+}
+
+static void collideShip(Ship *target)
+{
+    Collider ship;
+    shipCollider(*target, ship);
+    queryCollider(ship, gCollisionCandidates, false);
+    float time;
+
+    // Counted before the grid pass marks its hits destroyed. Every grid hit
+    // passes the exact test, so equal counts mean equal sets.
+    size_t expected = 0;
+    if(gCheckCollisions)
+    {
+        for(size_t j=0; j < gAsteroids.Size(); j++)
+        {
+            if(!gAsteroids.destroyed[j] && hitsAsteroid(ship, j, time)) expected++;
+        }
+    }
+
+    size_t hits = 0;
+    for(uint32_t j : gCollisionCandidates)
+    {
+        // An asteroid that already took another ship this tick is spent.
+        if(gAsteroids.destroyed[j]) continue;
+        if(hitsAsteroid(ship, j, time))
+        {
+            target->Destroy();
+            gAsteroids.destroyed[j] = 1;
+            emitSound(SOUND_SHIP_DESTROYED);
+            hits++;
+        }
+    }
+
+    if(gCheckCollisions)
+    {
+        if(expected != hits)
+        {
+            fprintf(stderr, "Ship collision mismatch: spatial hash %zu, brute force %zu\n", hits, expected);
+        }
+    }
+}
+
+void collideShips()
+{
+    PROFILE_SCOPE(PHASE_SHIP_COLLISION);
+    for(int s=0; s < gShipCount; s++)
+    {
+        if(!gShips[s]->Destroyed()) collideShip(gShips[s]);
+    }
+}
+
+// The live asteroid the bullet reaches first, ties going to the lower
+// index, or -1. Scans every asteroid when candidates is null.
+static int32_t firstHit(const Collider &bullet, const std::vector<uint32_t> *candidates, float &time, bool &more)
+{
+    int32_t hit = -1;
+    more = false;
+    size_t count = candidates ? candidates->size() : gAsteroids.Size();
+    for(size_t k=0; k < count; k++)
+    {
+        uint32_t j = candidates ? (*candidates)[k] : (uint32_t)k;
+        if(gAsteroids.destroyed[j]) continue;
+        float t;
+        if(!hitsAsteroid(bullet, j, t)) continue;
+        if(hit >= 0) more = true;
+        if(hit < 0 || t < time || (t == time && (int32_t)j < hit))
+        {
+            hit = (int32_t)j;
+            time = t;
+        }
+    }
+    return hit;
+}
+
+static void findBulletHits(size_t begin, size_t end, std::vector<uint32_t> *candidates)
+{
+    Collider bullet;
+    for(size_t i=begin; i < end; i++)
+    {
+        gBulletFirstHit[i] = -1;
+        gBulletMoreHits[i] = 0;
+        if(gBullets.destroyed[i]) continue;
+        bulletCollider(i, bullet);
+        if(candidates) queryCollider(bullet, *candidates, true);
+        bool more;
+        gBulletFirstHit[i] = firstHit(bullet, candidates, gBulletHitTime[i], more);
+        gBulletMoreHits[i] = more;
+    }
+}
+
+// Heap order for gBulletOrder: whether bullet a settles after bullet b.
+static bool settlesLater(uint32_t a, uint32_t b)
+{
+    return gBulletHitTime[a] > gBulletHitTime[b] || (gBulletHitTime[a] == gBulletHitTime[b] && a > b);
+}
+
+// Hits are settled earliest first, so when two bullets reach the same
+// asteroid the one that got there sooner takes it. A bullet whose target
+// was taken goes back on the heap at the time it reaches its next one, so
+// it can't take that one from a bullet that gets there sooner. Each bullet
+// is on the heap at most once, so it never outgrows the pool.
+static void resolveBulletHits(bool bruteForce)
+{
+    gBulletOrder.clear();
+    for(size_t i=0; i < gBullets.Size(); i++)
+    {
+        if(gBulletFirstHit[i] >= 0) gBulletOrder.push_back((uint32_t)i);
+    }
+    std::make_heap(gBulletOrder.begin(), gBulletOrder.end(), settlesLater);
+
+    while(!gBulletOrder.empty())
+    {
+        std::pop_heap(gBulletOrder.begin(), gBulletOrder.end(), settlesLater);
+        uint32_t i = gBulletOrder.back();
+        gBulletOrder.pop_back();
+
+        int32_t hit = gBulletFirstHit[i];
+        if(gAsteroids.destroyed[hit])
+        {
+            if(!gBulletMoreHits[i]) continue;
+            Collider bullet;
+            bulletCollider(i, bullet);
+            if(!bruteForce) queryCollider(bullet, gCollisionCandidates, true);
+            bool more;
+            hit = firstHit(bullet, bruteForce ? nullptr : &gCollisionCandidates, gBulletHitTime[i], more);
+            if(hit < 0) continue;
+            gBulletFirstHit[i] = hit;
+            gBulletMoreHits[i] = more;
+            gBulletOrder.push_back(i);
+            std::push_heap(gBulletOrder.begin(), gBulletOrder.end(), settlesLater);
+            continue;
+        }
+        gAsteroids.destroyed[hit] = 1;
+        gBullets.destroyed[i] = 1;
+    }
+}
+
+void collideBullets()
+{
+    PROFILE_SCOPE(PHASE_BULLET_COLLISION);
+
+    if(gCheckCollisions)
+    {
+        sInitialBullets = gBullets.destroyed;
+        sInitialAsteroids = gAsteroids.destroyed;
+        collideBulletsBruteForce();
+        sExpectedBullets = gBullets.destroyed;
+        sExpectedAsteroids = gAsteroids.destroyed;
+        gBullets.destroyed = sInitialBullets;
+        gAsteroids.destroyed = sInitialAsteroids;
+    }
+
+    // The sweeps run in parallel against the asteroids live at the start of
+    // the pass; resolving the hits is serial and in a fixed order, so the
+    // outcome doesn't depend on the thread count.
+    gBulletFirstHit.resize(gBullets.Size());
+    gBulletHitTime.resize(gBullets.Size());
+    gBulletMoreHits.resize(gBullets.Size());
+    gJobs.ParallelFor(gBullets.Size(), COLLIDE_GRAIN, [](size_t begin, size_t end) {
+        findBulletHits(begin, end, &gWorkerCandidates[JobSystem::WorkerIndex()]);
+    });
+    resolveBulletHits(false);
+
+    if(gCheckCollisions && (sExpectedBullets != gBullets.destroyed || sExpectedAsteroids != gAsteroids.destroyed))
+    {
+        fprintf(stderr, "Collision mismatch between spatial hash and brute force (%zu bullets, %zu asteroids)\n", gBullets.Size(), gAsteroids.Size());
+    }
+}
+
+void collideBulletsBruteForce()
+{
+    gBulletFirstHit.resize(gBullets.Size());
+    gBulletHitTime.resize(gBullets.Size());
+    gBulletMoreHits.resize(gBullets.Size());
+    findBulletHits(0, gBullets.Size(), nullptr);
+    resolveBulletHits(true);
+}
+
+void startGame()
+{
+    gIsGameStarted = true;
+    startWave();
+}
+
+void restartGame()
+{
+    gGameOver = false;
+    gIsGameStarted = false;
+    gIsWaveEnd = true;
+    gWave = 0;
+    gLives = gTuning.lives;
+    gScore = 0;
+    gNewWaveTimer = 0.0;
+    clear();
+    spawnShips();
+}
+
+// A Vogel spiral stretched over the playfield covers it evenly at any count.
+static void spawnStressWave()
+{
+    gAsteroids.Clear();
+    float rangeX = WIDTH / 2 - STRESS_CLEAR_RADIUS;
+    float rangeY = HEIGHT / 2 - STRESS_CLEAR_RADIUS;
+    for(size_t i=0; i < gStressAsteroids; i++)
+    {
+        float r = sqrtf((i + 0.5f) / gStressAsteroids);
+        float theta = fmodf(i * STRESS_GOLDEN_ANGLE, 2 * (float)PI);
+        float x = WIDTH / 2 + cosf(theta) * (STRESS_CLEAR_RADIUS + r * rangeX) - gAsteroidSizes[BIG].w / 2;
+        float y = HEIGHT / 2 + sinf(theta) * (STRESS_CLEAR_RADIUS + r * rangeY) - gAsteroidSizes[BIG].h / 2;
+        spawnAsteroid<BIG>(Vector2(x, y));
+    }
+}
+
+// gStressBullets bullets spread evenly round the centre, the whole fan
+// turning a little each tick.
+static void fireStressBullets()
+{
+    float x = WIDTH / 2 - gBulletSize.w / 2;
+    float y = HEIGHT / 2 - gBulletSize.h / 2;
+    for(size_t k=0; k < gStressBullets; k++)
+    {
+        float angle = fmodf(gTick * STRESS_FAN_STEP + k * 360.0f / gStressBullets, 360.0f);
+        Vector2 velocity = Vector2(-cosf(angle * (float)PI / 180) * BULLET_SPEED, -sinf(angle * (float)PI / 180) * BULLET_SPEED);
+        gBullets.Add(Vector2(x, y), velocity, angle, gBulletSize.w, gBulletSize.h);
+    }
+}
+
+void startWave()
+{
+    PROFILE_SCOPE(PHASE_START_WAVE);
+
+    if(gStressAsteroids > 0)
+    {
+        gWave++;
+        gIsWaveEnd = false;
+        spawnStressWave();
+    }
+    else if(gNewWaveTimer >= gTuning.newWaveTime)
+    {
+        gWave++;
+        gIsWaveEnd = false;
+        gNewWaveTimer = 0.0f;
+        // The asteroid pool is empty once a wave is cleared; resetting it
+        // restarts its handles. Bullets fired during the wave delay are
+        // still in play and carry on into the new wave.
+        gAsteroids.Clear();
+        int n = std::min(gWave+2, MAX_BIG_ASTEROIDS);
+        int xRange = 50 + 50 + 1;
+        int yRange = 50 + 50 + 1;
+        for(int i=0; i < n; i++)
+        {
+            int x = (int)(cos(2 * 3.14 * i / n) * gTuning.waveRadius + 0.5) + WIDTH/2 - 50 + gRng.Range(xRange) - 50;
+            int y = (int)(sin(2 * 3.14 * i / n) * gTuning.waveRadius + 0.5) + HEIGHT/2 - 40 + gRng.Range(yRange) - 50;
+            Vector2 pos = Vector2(+x, +y);
+            spawnAsteroid<BIG>(pos);
+        }
+    }
+    else
+    {
+        gNewWaveTimer += TICK_INTERVAL;
+    }
+}
+
+void queueInput(InputEvent event)
+{
+    gInputQueue.push_back(event);
+}
+
+void applyInput(InputEvent event)
+{
+    if(!gIsGameStarted)
+    {
+        if(event.pressed && event.action == INPUT_FIRE)
+        {
+            startGame();
+        }
+    }
+    else if(gGameOver)
+    {
+        if(event.pressed && event.action == INPUT_RESTART)
+        {
+            restartGame();
+        }
+    }
+    else if(event.player < gShipCount)
+    {
+        Ship *ship = gShips[event.player];
+        if(!ship->Destroyed()) {
+            ship->Input(event);
+        }
+    }
+}
+
+// Drops destroyed bullets and asteroids, scoring and splitting the
+// asteroids on the way out.
+static void removeDestroyed()
+{
+    PROFILE_SCOPE(PHASE_COMPACT);
+
+    // Walk backwards so the entity swapped into a hole has already been
+    // visited.
+    for(size_t i=gBullets.Size(); i-- > 0;)
+    {
+        if(gBullets.destroyed[i])
+        {
+            gBullets.Remove(i);
+        }
+    }
+
+    // Fragments are appended past the end, so only the asteroids that
+    // existed before the split are visited.
+    size_t count = gAsteroids.Size();
+    for(size_t i=0; i < count; i++)
+    {
+        if(gAsteroids.destroyed[i])
+        {
+            gScore += ASTEROID_ARCHETYPES[gAsteroids.type[i]].score;
+            emitSound(SOUND_EXPLOSION);
+            emitEffect((EffectKind)(EFFECT_DEBRIS + gAsteroids.type[i]), gAsteroids.x[i] + gAsteroids.width[i] / 2,
+                       gAsteroids.y[i] + gAsteroids.height[i] / 2, gAsteroids.vx[i], gAsteroids.vy[i], 0);
+            splitAsteroid(Vector2(gAsteroids.x[i], gAsteroids.y[i]), gAsteroids.type[i]);
+        }
+    }
+
+    for(size_t i=count; i-- > 0;)
+    {
+        if(gAsteroids.destroyed[i])
+        {
+            gAsteroids.Remove(i);
+        }
+    }
+}
+
+void tick()
+{
+    sTickSounds = 0;
+    gAsteroids.SavePrevious();
+    gBullets.SavePrevious();
+    for(int s=0; s < gShipCount; s++)
+    {
+        gShips[s]->SavePrevious();
+    }
+
+    if(gPlayer != nullptr)
+    {
+        // Playback owns the input; anything queued live is dropped.
+        gInputQueue.clear();
+        gPlayer->Input(gTick, gInputQueue);
+    }
+    if(gRecorder != nullptr && !gInputQueue.empty())
+    {
+        gRecorder->Input(gTick, gInputQueue.data(), gInputQueue.size());
+    }
+
+    for(auto &event : gInputQueue)
+    {
+        applyInput(event);
+    }
+    gInputQueue.clear();
+
+    if(gIsGameStarted && gIsWaveEnd)
+    {
+        startWave();
+    }
+    if(gIsGameStarted && !gGameOver && gStressBullets > 0)
+    {
+        fireStressBullets();
+    }
+
+    {
+        PROFILE_SCOPE(PHASE_UPDATE);
+        updateBullets();
+        updateAsteroids();
+        for(int s=0; s < gShipCount; s++)
+        {
+            gShips[s]->Update();
+        }
+
+        gAsteroidGrid.Build(gAsteroids.x.data(), gAsteroids.y.data(), gAsteroids.width.data(), gAsteroids.height.data(), nullptr, gAsteroids.Size());
+        gAsteroidGhosts.Build(gAsteroids.x.data(), gAsteroids.y.data(), gAsteroids.width.data(), gAsteroids.height.data(), gAsteroids.Size(), WIDTH, HEIGHT);
+    }
+
+    collideShips();
+
+    for(int s=0; s < gShipCount; s++)
+    {
+        if(!gShips[s]->Destroyed()) continue;
+        if(gLives <= 0)
+        {
+            gGameOver = true;
+        }
+        else
+        {
+            gShips[s]->Respawn();
+        }
+    }
+
+    collideBullets();
+
+    removeDestroyed();
+
+    if(gAsteroids.Size() == 0)
+    {
+        gIsWaveEnd = true;
+    }
+
+    if(gTick % REPLAY_CHECKSUM_INTERVAL == 0 && (gRecorder != nullptr || gPlayer != nullptr))
+    {
+        uint32_t checksum = stateChecksum();
+        if(gRecorder != nullptr)
+        {
+            gRecorder->Checksum(gTick, checksum);
+        }
+        if(gPlayer != nullptr && !gPlayer->Verify(gTick, checksum) && gDesyncTick == NO_DESYNC)
+        {
+            gDesyncTick = gTick;
+            fprintf(stderr, "Replay desync at tick %u\n", gTick);
+        }
+    }
+    gTick++;
+}
+
+static void hashBytes(uint32_t &hash, const void *data, size_t size)
+{
+    const uint8_t *bytes = (const uint8_t*)data;
+    for(size_t i=0; i < size; i++)
+    {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+}
+
+template<typename T>
+static void hashArray(uint32_t &hash, const std::vector<T> &values)
+{
+    hashBytes(hash, values.data(), values.size() * sizeof(T));
+}
+
+// FNV-1a over everything that feeds the next tick, bit for bit: what a
+// SaveState holds, plus the tuning.
+uint32_t stateChecksum()
+{
+    uint32_t hash = 2166136261u;
+    hashArray(hash, gAsteroids.x);
+    hashArray(hash, gAsteroids.y);
+    hashArray(hash, gAsteroids.vx);
+    hashArray(hash, gAsteroids.vy);
+    hashArray(hash, gAsteroids.angle);
+    hashArray(hash, gAsteroids.rotationSpeed);
+    hashArray(hash, gAsteroids.type);
+    hashArray(hash, gBullets.x);
+    hashArray(hash, gBullets.y);
+    hashArray(hash, gBullets.vx);
+    hashArray(hash, gBullets.vy);
+    hashArray(hash, gBullets.angle);
+
+    for(int s=0; s < gShipCount; s++)
+    {
+        if(gShips[s] == nullptr) continue;
+        ShipState ship = gShips[s]->Save();
+        hashBytes(hash, &ship, sizeof(ship));
+    }
+
+    int32_t counters[3] = {gLives, gScore, gWave};
+    uint8_t flags[4] = {gIsGameStarted, gIsWaveEnd, gGameOver, 0};
+    float timers[2] = {gNewWaveTimer, gAsteroidMaxStep};
+    uint64_t rng[2] = {gRng.State(), gRng.Increment()};
+    hashBytes(hash, counters, sizeof(counters));
+    hashBytes(hash, flags, sizeof(flags));
+    hashBytes(hash, timers, sizeof(timers));
+    hashBytes(hash, rng, sizeof(rng));
+    hashBytes(hash, &gTuning, sizeof(gTuning));
+    return hash;
+}
+
+void clear()
+{
+    gAsteroids.Clear();
+    gBullets.Clear();
+
+    for(int s=0; s < MAX_SHIPS; s++)
+    {
+        if(gShips[s] == nullptr) continue;
+        gShips[s]->~Ship();
+        gShips[s] = nullptr;
+    }
+}
+
+void spawnShips()
+{
+    for(int s=0; s < gShipCount; s++)
+    {
+        gShips[s] = new (sShipStorage[s]) Ship(s);
+    }
+}
+
+// Fill in missing sizes and hulls and derive the asteroid circles.
+static void prepareShapes()
+{
+    gAsteroidReach = 0.0f;
+    for(int t=0; t < ASTEROID_TYPES; t++)
+    {
+        if(gAsteroidSizes[t].w == 0) gAsteroidSizes[t] = {ASTEROID_ARCHETYPES[t].width, ASTEROID_ARCHETYPES[t].height};
+        Size size = gAsteroidSizes[t];
+        if(gAsteroidHulls[t].count == 0) gAsteroidHulls[t] = RectHull(size.w, size.h);
+        gAsteroidRadii[t] = sqrtf(gAsteroidHulls[t].area / (float)PI);
+        gAsteroidReach = std::max(gAsteroidReach, gAsteroidRadii[t] - std::min(size.w, size.h) * 0.5f);
+    }
+    if(gBulletHull.count == 0) gBulletHull = RectHull(gBulletSize.w, gBulletSize.h);
+    if(gShipHull.count == 0) gShipHull = RectHull(gShipSize.w, gShipSize.h);
+}
+
+void initSimulation()
+{
+    prepareShapes();
+    size_t maxAsteroids = MAX_ASTEROIDS + gStressAsteroids * STRESS_SPLIT_ROOM;
+    size_t maxBullets = MAX_BULLETS + gStressBullets * STRESS_BULLET_TICKS;
+    gAsteroids.Allocate(maxAsteroids);
+    gBullets.Allocate(maxBullets);
+    Size largest = {0, 0};
+    for(const Size &size : gAsteroidSizes)
+    {
+        largest.w = std::max(largest.w, size.w);
+        largest.h = std::max(largest.h, size.h);
+    }
+    gAsteroidGrid.Allocate(maxAsteroids, largest.w, largest.h);
+    gAsteroidGhosts.Reserve(maxAsteroids);
+    gCollisionCandidates.reserve(maxAsteroids);
+    gInputQueue.reserve(64);
+    gBulletFirstHit.reserve(maxBullets);
+    gBulletHitTime.reserve(maxBullets);
+    gBulletMoreHits.reserve(maxBullets);
+    gBulletOrder.reserve(maxBullets);
+    // Only the workers gJobs started ever query.
+    for(int i=0; i < gJobs.Threads(); i++)
+    {
+        gWorkerCandidates[i].reserve(maxAsteroids);
+        gAsteroidGrid.ReserveStamps(gWorkerStamps[i]);
+    }
+    sExpectedBullets.reserve(maxBullets);
+    sInitialBullets.reserve(maxBullets);
+    sExpectedAsteroids.reserve(maxAsteroids);
+    sInitialAsteroids.reserve(maxAsteroids);
+    gShipCount = std::min(std::max(gShipCount, 1), MAX_SHIPS);
+    gLives = gTuning.lives;
+    spawnShips();
+}
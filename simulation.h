@@ -0,0 +1,485 @@
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#include <stdint.h>
+#include <math.h>
+#include <vector>
+#include "game.h"
+#include "entities.h"
+#include "spatial_hash.h"
+#include "wrap.h"
+#include "tuning.h"
+#include "rng.h"
+#include "collision.h"
+#include "archetypes.h"
+#include "spsc_queue.h"
+
+// Game logic with no dependency on SDL, so it can run headless in the
+// benchmark as well as under the renderer in main.cpp.
+
+struct IntRect {
+    int x;
+    int y;
+    int w;
+    int h;
+};
+
+struct Size {
+    int w;
+    int h;
+};
+
+enum InputAction {
+    INPUT_THRUST,
+    INPUT_LEFT,
+    INPUT_RIGHT,
+    INPUT_FIRE,
+    INPUT_RESTART,
+};
+
+// player picks the ship; replays only hold player 0's input.
+struct InputEvent {
+    uint8_t action;
+    uint8_t pressed;
+    uint8_t player;
+};
+
+// Ships in play, one per player, all drawing on the shared lives. Set
+// gShipCount before initSimulation.
+#define MAX_SHIPS 4
+// Horizontal distance between neighbouring spawn points.
+#define SHIP_SPAWN_SPACING 120
+
+// Entity sizes in pixels. They default to the sprite atlas sizes; the
+// renderer overwrites them with the sprites it actually loaded.
+extern Size gAsteroidSizes[ASTEROID_TYPES];
+extern Size gBulletSize;
+extern Size gShipSize;
+
+// Collision outlines, set by the renderer from the sprites' alpha masks.
+// Any left empty are replaced with the entity's rectangle by initSimulation.
+// Asteroids collide as the circle with their hull's area; the ship and
+// bullets as their rotated hulls.
+extern Hull gAsteroidHulls[ASTEROID_TYPES];
+extern Hull gBulletHull;
+extern Hull gShipHull;
+
+extern Bullets gBullets;
+extern Asteroids gAsteroids;
+extern SpatialHash gAsteroidGrid;
+// Asteroids crossing a seam as of the last tick's move, for collision.
+extern GhostList gAsteroidGhosts;
+extern bool gCheckCollisions;
+// Fastest any asteroid has moved per tick; it only ever grows.
+extern float gAsteroidMaxStep;
+
+// Stress mode, for load testing: each wave spawns gStressAsteroids big
+// asteroids in a fixed spiral with no wave delay, and gStressBullets
+// bullets a tick fan out from the centre. 0 asteroids means normal waves.
+// Set both before initSimulation, which sizes the pools for them.
+extern size_t gStressAsteroids;
+extern size_t gStressBullets;
+
+// Every random draw in the simulation comes from gRng, so seeding it before
+// the first tick makes a run reproducible from its input alone.
+extern Rng gRng;
+extern uint32_t gTick;
+
+extern float gNewWaveTimer;
+
+extern int gLives;
+extern int gScore;
+extern int gWave;
+
+extern bool gIsGameStarted;
+extern bool gIsWaveEnd;
+extern bool gGameOver;
+
+// Sounds the simulation asks for. Each plays at most once per tick however
+// often it is emitted. They only reach gSoundQueue when one is set, so
+// headless runs stay silent, and they never affect the simulation.
+enum SoundId {
+    SOUND_LASER,
+    SOUND_EXPLOSION,
+    SOUND_SHIP_DESTROYED,
+    SOUND_COUNT,
+};
+
+#define SOUND_QUEUE_SIZE 64
+typedef SpscQueue<SoundId, SOUND_QUEUE_SIZE> SoundQueue;
+extern SoundQueue *gSoundQueue;
+void emitSound(SoundId sound);
+
+// Visual effects the simulation triggers, for the render thread's particle
+// system. Like sounds they only reach gEffectQueue when one is set, never
+// draw from gRng and never affect the simulation. The debris kinds follow
+// AsteroidType.
+enum EffectKind {
+    EFFECT_DEBRIS,
+    EFFECT_DEBRIS_LAST = EFFECT_DEBRIS + ASTEROID_TYPES - 1,
+    EFFECT_THRUST,
+    EFFECT_KINDS,
+};
+
+// x, y is the centre, vx, vy the emitter's own velocity in pixels a tick
+// and angle the direction it sprays in, in degrees like Ship's.
+struct Effect {
+    EffectKind kind;
+    float x;
+    float y;
+    float vx;
+    float vy;
+    float angle;
+};
+
+#define EFFECT_QUEUE_SIZE 1024
+typedef SpscQueue<Effect, EFFECT_QUEUE_SIZE> EffectQueue;
+extern EffectQueue *gEffectQueue;
+void emitEffect(EffectKind kind, float x, float y, float vx, float vy, float angle);
+
+// Everything about the ship that changes during play, for save states.
+struct ShipState {
+    Vector2 pos;
+    Vector2 velocity;
+    float angle;
+    float rotationDir;
+    float respawnTimer;
+    float shootTimer;
+    uint8_t moving;
+    uint8_t xPosDir;
+    uint8_t yPosDir;
+    uint8_t destroyed;
+};
+
+class Ship
+{
+    public:
+        // Player 0 spawns in the centre, the others alternately left and
+        // right of it.
+        Ship(int player) {
+            mIsMoving = false;
+            mRotationDir = 0;
+            mAngle = 90;
+            mXPosDir = true;
+            mYPosDir = true;
+            mDestroyed = false;
+
+            mRespawnTimer = 0.0f;
+            mShootTimer = gTuning.shipShootTime;
+
+            mWidth = gShipSize.w;
+            mHeight = gShipSize.h;
+            int side = (player + 1) / 2 * (player % 2 ? -1 : 1);
+            mSpawn = Vector2(WIDTH/2-mWidth/2 + side * SHIP_SPAWN_SPACING, HEIGHT/2-mHeight/2);
+            mPos = mSpawn;
+            mPrevPos = mPos;
+            mPrevAngle = mAngle;
+            shootPos = Vector2(mWidth/2, 0);
+        }
+        ~Ship() {
+        }
+
+        IntRect Rect()
+        {
+            return {(int)mPos.x, (int)mPos.y, mWidth, mHeight};
+        }
+
+        Vector2 Pos() const
+        {
+            return mPos;
+        }
+
+        Vector2 PrevPos() const
+        {
+            return mPrevPos;
+        }
+
+        // Movement over the last Update, before wrapping.
+        Vector2 Velocity() const
+        {
+            return mVelocity;
+        }
+
+        float Angle() const
+        {
+            return mAngle;
+        }
+
+        float PrevAngle() const
+        {
+            return mPrevAngle;
+        }
+
+        int Width() const
+        {
+            return mWidth;
+        }
+
+        int Height() const
+        {
+            return mHeight;
+        }
+
+        void Destroy()
+        {
+            mDestroyed = true;
+        }
+
+        bool Destroyed() const
+        {
+            return mDestroyed;
+        }
+
+        void Respawn()
+        {
+            if(mRespawnTimer >= gTuning.shipRespawnTime)
+            {
+                mDestroyed = false;
+                mPos = mSpawn;
+                mAngle = 90;
+                mIsMoving = false;
+                mXPosDir = true;
+                mYPosDir = true;
+                mRotationDir = 0;
+                mRespawnTimer = 0.0f;
+                mVelocity = Vector2(0, 0);
+                mPrevPos = mPos;
+                mPrevAngle = mAngle;
+                gLives--;
+            }
+            else
+            {
+                mRespawnTimer += TICK_INTERVAL;
+            }
+        }
+
+        // Remember the state at the start of a tick for render interpolation.
+        void SavePrevious()
+        {
+            mPrevPos = mPos;
+            mPrevAngle = mAngle;
+        }
+
+        ShipState Save() const
+        {
+            return {mPos, mVelocity, mAngle, mRotationDir, mRespawnTimer, mShootTimer,
+                    mIsMoving, mXPosDir, mYPosDir, mDestroyed};
+        }
+
+        // The previous state is set to the loaded one, so nothing is
+        // interpolated across the jump.
+        void Load(const ShipState &state)
+        {
+            mPos = state.pos;
+            mVelocity = state.velocity;
+            mAngle = state.angle;
+            mRotationDir = state.rotationDir;
+            mRespawnTimer = state.respawnTimer;
+            mShootTimer = state.shootTimer;
+            mIsMoving = state.moving != 0;
+            mXPosDir = state.xPosDir != 0;
+            mYPosDir = state.yPosDir != 0;
+            mDestroyed = state.destroyed != 0;
+            mPrevPos = mPos;
+            mPrevAngle = mAngle;
+        }
+
+        void Input(InputEvent event)
+        {
+            if(Destroyed()) return;
+            if(event.pressed)
+            {
+                switch (event.action)
+                {
+                case INPUT_THRUST:
+                    mIsMoving = true;
+                    break;
+                case INPUT_LEFT:
+                    mRotationDir = -gTuning.shipRotationSpeed;
+                    break;
+                case INPUT_RIGHT:
+                    mRotationDir = gTuning.shipRotationSpeed;
+                    break;
+                case INPUT_FIRE:
+                    Shoot();
+                    break;
+                }
+            }
+            else
+            {
+                switch (event.action)
+                {
+                case INPUT_THRUST:
+                    mIsMoving = false;
+                    break;
+                case INPUT_LEFT:
+                    mRotationDir = 0;
+                    break;
+                case INPUT_RIGHT:
+                    mRotationDir = 0;
+                    break;
+                }
+            }
+        }
+
+        void Update()
+        {
+            if(Destroyed()) return;
+            if(mIsMoving)
+            {
+                mVelocity = Vector2(-1 * cos(mAngle * PI / 180), -1 * sin(mAngle * PI / 180));
+                auto m = sqrt(mVelocity.x*mVelocity.x + mVelocity.y*mVelocity.y);
+                mVelocity.x /= m;
+                mVelocity.y /= m;
+
+                mVelocity.x *= gTuning.shipSpeed * gTuning.shipThrust;
+                mVelocity.y *= gTuning.shipSpeed * gTuning.shipThrust;
+
+                if(mVelocity.x > gTuning.shipSpeed)
+                    mVelocity.x = gTuning.shipSpeed;
+                
+                if(mVelocity.y > gTuning.shipSpeed)
+                    mVelocity.y = gTuning.shipSpeed;
+
+                if(mVelocity.x > 0) mXPosDir = true;
+                else mXPosDir = false;
+
+                if(mVelocity.y > 0) mYPosDir = true;
+                else mYPosDir = false;
+            }
+            else
+            {
+                float drag = gTuning.shipDrag;
+                if(mXPosDir && mVelocity.x > 0) mVelocity.x -= drag; 
+                else if(mVelocity.x < 0) mVelocity.x += drag;
+                else mVelocity.x = 0;
+
+                if(mYPosDir && mVelocity.y > 0) mVelocity.y -= drag;
+                else if(mVelocity.y < 0) mVelocity.y += drag;
+                else mVelocity.y = 0;
+            }
+
+            mPos.x += mVelocity.x;
+            mPos.y += mVelocity.y;
+            if(mRotationDir) mAngle += mRotationDir;
+            if(mAngle > 360) mAngle -= 360;
+            else if(mAngle < 360) mAngle += 360;
+
+            // Kept on the torus like the asteroids; see wrap.h.
+            if(mPos.x < 0)
+            {
+                mPos.x += WIDTH;
+            }
+            else if(mPos.x >= WIDTH)
+            {
+                mPos.x -= WIDTH;
+            }
+
+            if(mPos.y < 0)
+            {
+                mPos.y += HEIGHT;
+            }
+            else if(mPos.y >= HEIGHT)
+            {
+                mPos.y -= HEIGHT;
+            }
+
+            if(mShootTimer < gTuning.shipShootTime)
+            {
+                mShootTimer += TICK_INTERVAL;
+            }
+
+            if(mIsMoving)
+            {
+                // From the tail, sprayed backwards.
+                float c = cos(mAngle * PI / 180);
+                float s = sin(mAngle * PI / 180);
+                emitEffect(EFFECT_THRUST, mPos.x + mWidth/2 + c * mHeight/2, mPos.y + mHeight/2 + s * mHeight/2,
+                           mVelocity.x, mVelocity.y, mAngle);
+            }
+        }
+
+        void Shoot() {
+            if(mShootTimer >= gTuning.shipShootTime)
+            {
+                Vector2 direction = Vector2(-cos(mAngle * PI / 180), -sin(mAngle * PI / 180));
+                auto m = sqrt(direction.x*direction.x + direction.y*direction.y);
+                direction.x /= m;
+                direction.y /= m;
+
+                // bulletPos = Vector2((mPos.x + 45) + mWidth / 2 * direction.x, mPos.y + mHeight / 2 * direction.y);
+
+                Vector2 bulletPos = Vector2(mPos.x + shootPos.x, mPos.y + shootPos.y);
+                Vector2 velocity = Vector2(direction.x * gTuning.bulletSpeed, direction.y * gTuning.bulletSpeed);
+
+                gBullets.Add(bulletPos, velocity, mAngle, gBulletSize.w, gBulletSize.h);
+                emitSound(SOUND_LASER);
+                mShootTimer = 0.0f;
+            }
+        }
+
+    private:
+        Vector2 mSpawn;
+        Vector2 mPos;
+        Vector2 mPrevPos;
+        Vector2 shootPos;
+        Vector2 mVelocity;
+        bool mIsMoving;
+        float mRotationDir;
+        int mWidth;
+        int mHeight;
+        float mAngle;
+        float mPrevAngle;
+
+        // Speeds and times come from gTuning.
+        float mRespawnTimer;
+        float mShootTimer;
+
+        bool mXPosDir;
+        bool mYPosDir;
+        bool mDestroyed;
+};
+
+extern int gShipCount;
+extern Ship *gShips[MAX_SHIPS];
+
+bool collide(IntRect a, IntRect b);
+// Index of the new asteroid, or -1 when the pool is full.
+ptrdiff_t spawnAsteroid(Vector2 pos, AsteroidType type);
+// Replaces a destroyed asteroid of type with its archetype's fragments.
+void splitAsteroid(Vector2 pos, AsteroidType type);
+void updateAsteroids();
+void updateBullets();
+void collideShips();
+void collideBullets();
+void collideBulletsBruteForce();
+void startGame();
+void restartGame();
+void startWave();
+void clear();
+void spawnShips();
+// Sizes every pool and buffer the simulation uses and spawns the ships.
+// Call once, after gJobs.Start and once the entity sizes are known.
+void initSimulation();
+
+// Input is queued as it arrives and applied at the start of the next tick,
+// so the simulation only ever changes inside tick().
+void queueInput(InputEvent event);
+void tick();
+
+// Replays hook in at tick boundaries: the recorder stores what tick() applied,
+// the player replaces live input, and both compare state checksums every
+// REPLAY_CHECKSUM_INTERVAL ticks. gDesyncTick is the first mismatch, or
+// NO_DESYNC; tick 0 is checked too, so it can't stand for none.
+#define REPLAY_CHECKSUM_INTERVAL 60
+#define NO_DESYNC UINT32_MAX
+
+class ReplayRecorder;
+class ReplayPlayer;
+extern ReplayRecorder *gRecorder;
+extern ReplayPlayer *gPlayer;
+extern uint32_t gDesyncTick;
+
+uint32_t stateChecksum();
+
+#endif
@@ -0,0 +1,63 @@
+#include "snapshot.h"
+
+template<typename T>
+static void copyArray(std::vector<T> &to, const std::vector<T> &from)
+{
+    to.assign(from.begin(), from.end());
+}
+
+void Snapshot::Allocate(size_t asteroids, size_t bullets)
+{
+    asteroidPrevX.reserve(asteroids);
+    asteroidPrevY.reserve(asteroids);
+    asteroidPrevAngle.reserve(asteroids);
+    asteroidX.reserve(asteroids);
+    asteroidY.reserve(asteroids);
+    asteroidAngle.reserve(asteroids);
+    asteroidWidth.reserve(asteroids);
+    asteroidHeight.reserve(asteroids);
+    asteroidType.reserve(asteroids);
+
+    bulletPrevX.reserve(bullets);
+    bulletPrevY.reserve(bullets);
+    bulletX.reserve(bullets);
+    bulletY.reserve(bullets);
+    bulletAngle.reserve(bullets);
+    bulletWidth.reserve(bullets);
+    bulletHeight.reserve(bullets);
+}
+
+void Snapshot::Capture()
+{
+    copyArray(asteroidPrevX, gAsteroids.prevX);
+    copyArray(asteroidPrevY, gAsteroids.prevY);
+    copyArray(asteroidPrevAngle, gAsteroids.prevAngle);
+    copyArray(asteroidX, gAsteroids.x);
+    copyArray(asteroidY, gAsteroids.y);
+    copyArray(asteroidAngle, gAsteroids.angle);
+    copyArray(asteroidWidth, gAsteroids.width);
+    copyArray(asteroidHeight, gAsteroids.height);
+    copyArray(asteroidType, gAsteroids.type);
+
+    copyArray(bulletPrevX, gBullets.prevX);
+    copyArray(bulletPrevY, gBullets.prevY);
+    copyArray(bulletX, gBullets.x);
+    copyArray(bulletY, gBullets.y);
+    copyArray(bulletAngle, gBullets.angle);
+    copyArray(bulletWidth, gBullets.width);
+    copyArray(bulletHeight, gBullets.height);
+
+    shipCount = gShipCount;
+    for(int s=0; s < gShipCount; s++)
+    {
+        const Ship *ship = gShips[s];
+        ships[s] = {ship->PrevPos(), ship->Pos(), ship->PrevAngle(), ship->Angle(), ship->Width(), ship->Height(), ship->Destroyed()};
+    }
+
+    score = gScore;
+    lives = gLives;
+    wave = gWave;
+    started = gIsGameStarted;
+    waveEnd = gIsWaveEnd;
+    gameOver = gGameOver;
+}
@@ -0,0 +1,126 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stdint.h>
+#include <atomic>
+#include <vector>
+#include "simulation.h"
+#include "profiler.h"
+
+struct ShipView {
+    Vector2 prevPos;
+    Vector2 pos;
+    float prevAngle;
+    float angle;
+    int width;
+    int height;
+    bool destroyed;
+};
+
+// Everything the renderer needs from the simulation at one point in time:
+// last and current transforms for interpolation, and the HUD state. The
+// renderer only ever reads snapshots, never the simulation's own arrays.
+struct Snapshot {
+    std::vector<float> asteroidPrevX;
+    std::vector<float> asteroidPrevY;
+    std::vector<float> asteroidPrevAngle;
+    std::vector<float> asteroidX;
+    std::vector<float> asteroidY;
+    std::vector<float> asteroidAngle;
+    std::vector<int> asteroidWidth;
+    std::vector<int> asteroidHeight;
+    std::vector<AsteroidType> asteroidType;
+
+    std::vector<float> bulletPrevX;
+    std::vector<float> bulletPrevY;
+    std::vector<float> bulletX;
+    std::vector<float> bulletY;
+    std::vector<float> bulletAngle;
+    std::vector<int> bulletWidth;
+    std::vector<int> bulletHeight;
+
+    ShipView ships[MAX_SHIPS];
+    int shipCount;
+
+    int score;
+    int lives;
+    int wave;
+    bool started;
+    bool waveEnd;
+    bool gameOver;
+
+    // Performance counter value the current tick belongs to; the renderer
+    // interpolates by how far past it the frame is drawn.
+    uint64_t tickTime;
+    // Counter value when the newest input already applied was polled, or 0.
+    uint64_t inputTime;
+
+    bool profiling;
+    bool showProfiler;
+    // The simulation thread's last finished profiler frame. Its start time
+    // tells the renderer a new frame from a repeat.
+    double simFrameStart;
+    float simFrameDuration;
+    float simPhases[PHASE_COUNT];
+
+    // Size every array for the pool capacities so Capture never allocates.
+    void Allocate(size_t asteroids, size_t bullets);
+    // Copy the entity and HUD state out of the simulation globals.
+    void Capture();
+};
+
+// Lock-free single-producer single-consumer triple buffer. The producer
+// fills Back() and publishes it; the consumer picks up the newest published
+// slot. Neither side ever waits for the other, and frames the consumer was
+// too slow for are skipped rather than queued.
+template<typename T>
+class TripleBuffer
+{
+    public:
+        TripleBuffer()
+        {
+            mBack = 0;
+            mMiddle = 1;
+            mFront = 2;
+        }
+
+        T &Back()
+        {
+            return mSlots[mBack];
+        }
+
+        void Publish()
+        {
+            mBack = mMiddle.exchange(mBack | FRESH, std::memory_order_acq_rel) & INDEX;
+        }
+
+        // Swap in the newest published slot. False when nothing new has
+        // been published since the last call.
+        bool Update()
+        {
+            if((mMiddle.load(std::memory_order_relaxed) & FRESH) == 0) return false;
+            mFront = mMiddle.exchange(mFront, std::memory_order_acq_rel) & INDEX;
+            return true;
+        }
+
+        const T &Front() const
+        {
+            return mSlots[mFront];
+        }
+
+        T *Slots()
+        {
+            return mSlots;
+        }
+
+    private:
+        static const int INDEX = 3;
+        static const int FRESH = 4;
+
+        T mSlots[3];
+        int mBack;
+        int mFront;
+        std::atomic<int> mMiddle;
+};
+
+#endif
@@ -0,0 +1,177 @@
+#include "spatial_hash.h"
+#include <algorithm>
+#include <math.h>
+
+SpatialHash::SpatialHash(int width, int height, int cellSize)
+{
+    mCellSize = cellSize;
+    mColumns = (width + cellSize - 1) / cellSize;
+    mRows = (height + cellSize - 1) / cellSize;
+    mCellStart.assign(mColumns * mRows + 1, 0);
+    mQuery = 0;
+}
+
+int SpatialHash::Column(int x) const
+{
+    int c = (int)floorf((float)x / mCellSize) % mColumns;
+    return c < 0 ? c + mColumns : c;
+}
+
+int SpatialHash::Row(int y) const
+{
+    int r = (int)floorf((float)y / mCellSize) % mRows;
+    return r < 0 ? r + mRows : r;
+}
+
+void SpatialHash::Span(int x, int y, int w, int h, int &col0, int &cols, int &row0, int &rows) const
+{
+    // Count cells in unwrapped space, then clamp to the grid so a box wider
+    // than the playfield visits every column once.
+    int left = (int)floorf((float)x / mCellSize);
+    int right = (int)floorf((float)(x + w) / mCellSize);
+    int top = (int)floorf((float)y / mCellSize);
+    int bottom = (int)floorf((float)(y + h) / mCellSize);
+    col0 = Column(x);
+    row0 = Row(y);
+    cols = std::min(right - left + 1, mColumns);
+    rows = std::min(bottom - top + 1, mRows);
+}
+
+void SpatialHash::Allocate(size_t count, int maxWidth, int maxHeight)
+{
+    size_t cols = std::min(maxWidth / mCellSize + 2, mColumns);
+    size_t rows = std::min(maxHeight / mCellSize + 2, mRows);
+    mStamps.resize(std::max(mStamps.size(), count), 0);
+    mItems.reserve(count * cols * rows);
+    mCursors.reserve(mCellStart.size());
+}
+
+void SpatialHash::Build(const float *x, const float *y, const int *w, const int *h, const uint8_t *skip, size_t count)
+{
+    std::fill(mCellStart.begin(), mCellStart.end(), 0);
+    if(mStamps.size() < count)
+    {
+        mStamps.resize(count, 0);
+    }
+
+    // Counting sort: size each cell, prefix-sum into offsets, then fill.
+    int col0, cols, row0, rows;
+    size_t total = 0;
+    for(size_t i=0; i < count; i++)
+    {
+        if(skip && skip[i]) continue;
+        Span((int)x[i], (int)y[i], w[i], h[i], col0, cols, row0, rows);
+        for(int r=0; r < rows; r++)
+        {
+            int row = (row0 + r) % mRows;
+            for(int c=0; c < cols; c++)
+            {
+                mCellStart[row * mColumns + (col0 + c) % mColumns + 1]++;
+            }
+        }
+        total += cols * rows;
+    }
+    for(size_t c=1; c < mCellStart.size(); c++)
+    {
+        mCellStart[c] += mCellStart[c-1];
+    }
+
+    mItems.resize(total);
+    mCursors.assign(mCellStart.begin(), mCellStart.end() - 1);
+    for(size_t i=0; i < count; i++)
+    {
+        if(skip && skip[i]) continue;
+        Span((int)x[i], (int)y[i], w[i], h[i], col0, cols, row0, rows);
+        for(int r=0; r < rows; r++)
+        {
+            int row = (row0 + r) % mRows;
+            for(int c=0; c < cols; c++)
+            {
+                int cell = row * mColumns + (col0 + c) % mColumns;
+                mItems[mCursors[cell]++] = (uint32_t)i;
+            }
+        }
+    }
+    std::fill(mStamps.begin(), mStamps.end(), 0);
+    mQuery = 0;
+}
+
+void SpatialHash::Query(int x, int y, int w, int h, std::vector<uint32_t> &out) const
+{
+    out.clear();
+    if(++mQuery == 0)
+    {
+        std::fill(mStamps.begin(), mStamps.end(), 0);
+        mQuery = 1;
+    }
+
+    int col0, cols, row0, rows;
+    Span(x, y, w, h, col0, cols, row0, rows);
+    for(int r=0; r < rows; r++)
+    {
+        int row = (row0 + r) % mRows;
+        for(int c=0; c < cols; c++)
+        {
+            int cell = row * mColumns + (col0 + c) % mColumns;
+            for(uint32_t k=mCellStart[cell]; k < mCellStart[cell+1]; k++)
+            {
+                uint32_t id = mItems[k];
+                if(mStamps[id] != mQuery)
+                {
+                    mStamps[id] = mQuery;
+                    out.push_back(id);
+                }
+            }
+        }
+    }
+}
+
+void SpatialHash::ReserveStamps(QueryStamps &stamps) const
+{
+    if(stamps.stamps.size() < mStamps.size())
+    {
+        stamps.stamps.resize(mStamps.size(), 0);
+    }
+}
+
+void SpatialHash::QueryConcurrent(int x, int y, int w, int h, QueryStamps &stamps, std::vector<uint32_t> &out) const
+{
+    out.clear();
+    ReserveStamps(stamps);
+    // The count only ever goes up, so stamps left from before the last
+    // Build can't match; they need clearing only when it wraps.
+    if(++stamps.query == 0)
+    {
+        std::fill(stamps.stamps.begin(), stamps.stamps.end(), 0);
+        stamps.query = 1;
+    }
+
+    int col0, cols, row0, rows;
+    Span(x, y, w, h, col0, cols, row0, rows);
+    for(int r=0; r < rows; r++)
+    {
+        int row = (row0 + r) % mRows;
+        for(int c=0; c < cols; c++)
+        {
+            int cell = row * mColumns + (col0 + c) % mColumns;
+            for(uint32_t k=mCellStart[cell]; k < mCellStart[cell+1]; k++)
+            {
+                uint32_t id = mItems[k];
+                if(stamps.stamps[id] != stamps.query)
+                {
+                    stamps.stamps[id] = stamps.query;
+                    out.push_back(id);
+                }
+            }
+        }
+    }
+    if(cols * rows > 1)
+    {
+        std::sort(out.begin(), out.end());
+    }
+}
+
+size_t SpatialHash::Memory() const
+{
+    return (mCellStart.capacity() + mItems.capacity() + mCursors.capacity() + mStamps.capacity()) * sizeof(uint32_t);
+}
@@ -0,0 +1,67 @@
+#ifndef SPATIAL_HASH_H
+#define SPATIAL_HASH_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+// What QueryConcurrent marks ids with so each is reported once, kept by
+// the caller so every thread can have its own.
+struct QueryStamps {
+    std::vector<uint32_t> stamps;
+    uint32_t query;
+};
+
+// Uniform grid over a toroidal playfield. Cell coordinates wrap, so a box
+// hanging off one edge is filed under the cells on the opposite edge and
+// no pair that overlaps on screen can be missed. It only produces
+// candidates; callers still run the exact overlap test.
+class SpatialHash
+{
+    public:
+        SpatialHash(int width, int height, int cellSize);
+
+        // Size the buffers for count entities no larger than maxWidth x
+        // maxHeight so Build and Query never allocate.
+        void Allocate(size_t count, int maxWidth, int maxHeight);
+
+        // Rebuild from scratch. Entities with skip[i] set are left out; skip
+        // may be nullptr.
+        void Build(const float *x, const float *y, const int *w, const int *h, const uint8_t *skip, size_t count);
+
+        // Replace out with the ids of every entity sharing a cell with the
+        // box, each listed once.
+        void Query(int x, int y, int w, int h, std::vector<uint32_t> &out) const;
+
+        // Query with the caller's stamps instead of the shared ones, so any
+        // number of threads, each with its own stamps, may call it at once
+        // between Builds. The ids come out sorted ascending. Size the stamps
+        // with ReserveStamps so this never allocates.
+        void QueryConcurrent(int x, int y, int w, int h, QueryStamps &stamps, std::vector<uint32_t> &out) const;
+        void ReserveStamps(QueryStamps &stamps) const;
+
+        // Bytes of storage held.
+        size_t Memory() const;
+
+    private:
+        int Column(int x) const;
+        int Row(int y) const;
+        void Span(int x, int y, int w, int h, int &col0, int &cols, int &row0, int &rows) const;
+
+        int mCellSize;
+        int mColumns;
+        int mRows;
+
+        // Entity ids bucketed by cell: the ids in cell c are
+        // mItems[mCellStart[c]] .. mItems[mCellStart[c+1]-1].
+        std::vector<uint32_t> mCellStart;
+        std::vector<uint32_t> mItems;
+        std::vector<uint32_t> mCursors;
+
+        // Query stamps each id so an entity spanning several cells is only
+        // reported once.
+        mutable std::vector<uint32_t> mStamps;
+        mutable uint32_t mQuery;
+};
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <stddef.h>
+#include <atomic>
+
+// Lock-free single-producer single-consumer ring holding up to N - 1 items.
+// Push fails when the ring is full rather than waiting or allocating.
+template<typename T, size_t N>
+class SpscQueue
+{
+    public:
+        SpscQueue()
+        {
+            mHead = 0;
+            mTail = 0;
+        }
+
+        bool Push(const T &value)
+        {
+            size_t head = mHead.load(std::memory_order_relaxed);
+            size_t next = (head + 1) % N;
+            if(next == mTail.load(std::memory_order_acquire)) return false;
+            mItems[head] = value;
+            mHead.store(next, std::memory_order_release);
+            return true;
+        }
+
+        bool Pop(T &value)
+        {
+            size_t tail = mTail.load(std::memory_order_relaxed);
+            if(tail == mHead.load(std::memory_order_acquire)) return false;
+            value = mItems[tail];
+            mTail.store((tail + 1) % N, std::memory_order_release);
+            return true;
+        }
+
+    private:
+        T mItems[N];
+        // Apart so the two threads don't share a cache line.
+        alignas(64) std::atomic<size_t> mHead;
+        alignas(64) std::atomic<size_t> mTail;
+};
+
+#endif
@@ -0,0 +1,163 @@
+#include "text.h"
+#include <string.h>
+
+#define GLYPH_ATLAS_WIDTH 512
+
+GlyphAtlas::GlyphAtlas(SDL_Renderer *renderer, TTF_Font *font)
+{
+    mTexture = {nullptr, nullptr, 0, 0, 0};
+    mHeight = TTF_FontHeight(font);
+
+    SDL_Surface *glyphs[LAST_GLYPH - FIRST_GLYPH + 1];
+    int x = 0;
+    int y = 0;
+    for(int c = FIRST_GLYPH; c <= LAST_GLYPH; c++)
+    {
+        int i = c - FIRST_GLYPH;
+        int minx, maxx, miny, maxy;
+        if(TTF_GlyphMetrics(font, (Uint16)c, &minx, &maxx, &miny, &maxy, &mAdvances[i]) != 0)
+        {
+            mAdvances[i] = 0;
+        }
+
+        // Render solid to keep the same look as TTF_RenderText_Solid, then
+        // convert so the glyph can be blitted into an RGBA atlas.
+        glyphs[i] = nullptr;
+        SDL_Surface *surface = TTF_RenderGlyph_Solid(font, (Uint16)c, {255, 255, 255, 255});
+        if(surface != nullptr)
+        {
+            glyphs[i] = SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_RGBA32, 0);
+            SDL_FreeSurface(surface);
+        }
+
+        int w = glyphs[i] ? glyphs[i]->w : 0;
+        int h = glyphs[i] ? glyphs[i]->h : 0;
+        if(x + w > GLYPH_ATLAS_WIDTH)
+        {
+            x = 0;
+            y += mHeight + 1;
+        }
+        mGlyphs[i] = {x, y, w, h};
+        x += w + 1;
+    }
+
+    SDL_Surface *atlas = SDL_CreateRGBSurfaceWithFormat(0, GLYPH_ATLAS_WIDTH, y + mHeight + 1, 32, SDL_PIXELFORMAT_RGBA32);
+    if(atlas == nullptr)
+    {
+        SDL_Log("Unable to create glyph atlas! SDL Error: %s\n", SDL_GetError());
+    }
+    else
+    {
+        SDL_FillRect(atlas, nullptr, 0);
+    }
+
+    for(int i = 0; i <= LAST_GLYPH - FIRST_GLYPH; i++)
+    {
+        if(glyphs[i] == nullptr) continue;
+        if(atlas != nullptr)
+        {
+            SDL_SetSurfaceBlendMode(glyphs[i], SDL_BLENDMODE_NONE);
+            SDL_BlitSurface(glyphs[i], nullptr, atlas, &mGlyphs[i]);
+        }
+        SDL_FreeSurface(glyphs[i]);
+    }
+
+    if(atlas != nullptr)
+    {
+        mTexture.texture = SDL_CreateTextureFromSurface(renderer, atlas);
+        if(mTexture.texture == nullptr)
+        {
+            SDL_Log("Unable to create glyph atlas texture! SDL Error: %s\n", SDL_GetError());
+        }
+        else
+        {
+            SDL_SetTextureBlendMode(mTexture.texture, SDL_BLENDMODE_BLEND);
+            mTexture.width = atlas->w;
+            mTexture.height = atlas->h;
+        }
+        SDL_FreeSurface(atlas);
+    }
+}
+
+GlyphAtlas::~GlyphAtlas()
+{
+    SDL_DestroyTexture(mTexture.texture);
+    mTexture.texture = nullptr;
+}
+
+const SDL_Rect *GlyphAtlas::Glyph(char c) const
+{
+    if(c < FIRST_GLYPH || c > LAST_GLYPH) return nullptr;
+    return &mGlyphs[c - FIRST_GLYPH];
+}
+
+int GlyphAtlas::Advance(char c) const
+{
+    if(c < FIRST_GLYPH || c > LAST_GLYPH) return 0;
+    return mAdvances[c - FIRST_GLYPH];
+}
+
+TextLabel::TextLabel(const GlyphAtlas *glyphs)
+{
+    mGlyphs = glyphs;
+    mText[0] = '\0';
+    mBox = {0, 0, 0, 0};
+    mVertices.reserve(MAX_LABEL_LENGTH * 4);
+}
+
+void TextLabel::Set(const char *text, const SDL_Rect &box)
+{
+    if(strncmp(text, mText, MAX_LABEL_LENGTH) == 0 &&
+       box.x == mBox.x && box.y == mBox.y && box.w == mBox.w && box.h == mBox.h)
+    {
+        return;
+    }
+    strncpy(mText, text, MAX_LABEL_LENGTH - 1);
+    mText[MAX_LABEL_LENGTH - 1] = '\0';
+    mBox = box;
+    Layout();
+}
+
+void TextLabel::Layout()
+{
+    mVertices.clear();
+    if(!mGlyphs->Valid()) return;
+
+    int width = 0;
+    for(const char *c = mText; *c; c++)
+    {
+        width += mGlyphs->Advance(*c);
+    }
+    if(width == 0) return;
+
+    const Texture *texture = mGlyphs->GetTexture();
+    float scaleX = (float)mBox.w / width;
+    float scaleY = (float)mBox.h / mGlyphs->Height();
+    float pen = (float)mBox.x;
+    for(const char *c = mText; *c; c++)
+    {
+        const SDL_Rect *glyph = mGlyphs->Glyph(*c);
+        if(glyph != nullptr && glyph->w > 0)
+        {
+            float x0 = pen;
+            float y0 = (float)mBox.y;
+            float x1 = x0 + glyph->w * scaleX;
+            float y1 = y0 + glyph->h * scaleY;
+            float u0 = (float)glyph->x / texture->width;
+            float v0 = (float)glyph->y / texture->height;
+            float u1 = (float)(glyph->x + glyph->w) / texture->width;
+            float v1 = (float)(glyph->y + glyph->h) / texture->height;
+            mVertices.push_back({{x0, y0}, {255, 255, 255, 255}, {u0, v0}});
+            mVertices.push_back({{x1, y0}, {255, 255, 255, 255}, {u1, v0}});
+            mVertices.push_back({{x1, y1}, {255, 255, 255, 255}, {u1, v1}});
+            mVertices.push_back({{x0, y1}, {255, 255, 255, 255}, {u0, v1}});
+        }
+        pen += mGlyphs->Advance(*c) * scaleX;
+    }
+}
+
+void TextLabel::Draw(SpriteBatch *batch) const
+{
+    if(mVertices.empty()) return;
+    batch->DrawQuads(mGlyphs->GetTexture()->texture, mVertices.data(), (int)mVertices.size() / 4);
+}
@@ -0,0 +1,68 @@
+#ifndef TEXT_H
+#define TEXT_H
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+#include <vector>
+#include "atlas.h"
+
+#define FIRST_GLYPH 32
+#define LAST_GLYPH 126
+#define MAX_LABEL_LENGTH 64
+
+// Every printable ASCII glyph of a font rasterized once into one texture.
+class GlyphAtlas
+{
+    public:
+        GlyphAtlas(SDL_Renderer *renderer, TTF_Font *font);
+        ~GlyphAtlas();
+
+        bool Valid() const
+        {
+            return mTexture.texture != nullptr;
+        }
+
+        const Texture *GetTexture() const
+        {
+            return &mTexture;
+        }
+
+        // nullptr for characters outside FIRST_GLYPH..LAST_GLYPH.
+        const SDL_Rect *Glyph(char c) const;
+        int Advance(char c) const;
+
+        int Height() const
+        {
+            return mHeight;
+        }
+
+    private:
+        Texture mTexture;
+        SDL_Rect mGlyphs[LAST_GLYPH - FIRST_GLYPH + 1];
+        int mAdvances[LAST_GLYPH - FIRST_GLYPH + 1];
+        int mHeight;
+};
+
+// A string laid out as quads from a GlyphAtlas. The quads are only rebuilt
+// when the text or the box changes, so drawing an unchanged label is a copy
+// into the sprite batch.
+class TextLabel
+{
+    public:
+        TextLabel(const GlyphAtlas *glyphs);
+
+        // The text is stretched to fill box, the same way the old
+        // TTF_RenderText textures were stretched over their SDL_Rect.
+        void Set(const char *text, const SDL_Rect &box);
+        void Draw(SpriteBatch *batch) const;
+
+    private:
+        void Layout();
+
+        const GlyphAtlas *mGlyphs;
+        char mText[MAX_LABEL_LENGTH];
+        SDL_Rect mBox;
+        std::vector<SDL_Vertex> mVertices;
+};
+
+#endif
@@ -0,0 +1,111 @@
+#include "texture_cache.h"
+#include <SDL2/SDL_image.h>
+#include <string.h>
+
+TextureCache::TextureCache(SDL_Renderer *renderer)
+{
+    mRenderer = renderer;
+    mHits = 0;
+    mMisses = 0;
+}
+
+TextureCache::~TextureCache()
+{
+    for(auto &entry : mEntries)
+    {
+        if(entry->texture.refs > 0)
+        {
+            SDL_Log("Texture %s still has %d references\n", entry->path.c_str(), entry->texture.refs);
+        }
+        SDL_DestroyTexture(entry->texture.texture);
+    }
+    mEntries.clear();
+    mRenderer = nullptr;
+}
+
+bool TextureCache::Adopt(const char *path, SDL_Surface *surface)
+{
+    Entry *entry = Find(path);
+    if(entry == nullptr)
+    {
+        entry = Create(path, surface);
+    }
+    return entry != nullptr;
+}
+
+Texture *TextureCache::Acquire(const char *path)
+{
+    Entry *entry = Find(path);
+    if(entry != nullptr)
+    {
+        mHits++;
+    }
+    else
+    {
+        mMisses++;
+        SDL_Log("Texture cache miss: %s\n", path);
+        entry = Load(path);
+        if(entry == nullptr)
+        {
+            return nullptr;
+        }
+    }
+    entry->texture.refs++;
+    return &entry->texture;
+}
+
+void TextureCache::Release(Texture *texture)
+{
+    if(texture == nullptr) return;
+    if(texture->refs > 0)
+    {
+        texture->refs--;
+    }
+}
+
+TextureCache::Entry *TextureCache::Find(const char *path)
+{
+    // A linear scan is cheaper than hashing a std::string for the dozen
+    // textures the game uses, and it does not allocate.
+    for(auto &entry : mEntries)
+    {
+        if(strcmp(entry->path.c_str(), path) == 0)
+        {
+            return entry.get();
+        }
+    }
+    return nullptr;
+}
+
+TextureCache::Entry *TextureCache::Load(const char *path)
+{
+    SDL_Surface *surface = IMG_Load(path);
+    if(surface == nullptr)
+    {
+        SDL_Log("Unable to load image %s! SDL_image Error: %s\n", path, IMG_GetError());
+        return nullptr;
+    }
+    Entry *entry = Create(path, surface);
+    SDL_FreeSurface(surface);
+    return entry;
+}
+
+TextureCache::Entry *TextureCache::Create(const char *path, SDL_Surface *surface)
+{
+    SDL_Texture *texture = SDL_CreateTextureFromSurface(mRenderer, surface);
+    if(texture == nullptr)
+    {
+        SDL_Log("Unable to create texture from %s! SDL Error: %s\n", path, SDL_GetError());
+        return nullptr;
+    }
+
+    std::unique_ptr<Entry> entry(new Entry());
+    entry->path = path;
+    entry->texture.texture = texture;
+    entry->texture.path = entry->path.c_str();
+    entry->texture.refs = 0;
+    SDL_QueryTexture(texture, nullptr, nullptr, &entry->texture.width, &entry->texture.height);
+
+    mEntries.push_back(std::move(entry));
+    return mEntries.back().get();
+}
@@ -0,0 +1,63 @@
+#ifndef TEXTURE_CACHE_H
+#define TEXTURE_CACHE_H
+
+#include <SDL2/SDL.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct Texture {
+    SDL_Texture *texture;
+    // Source image, owned by the cache. Null for textures built in memory.
+    const char *path;
+    int width;
+    int height;
+    int refs;
+};
+
+// Loads every image once and hands out shared, reference-counted handles so
+// that spawning an entity never touches the disk or uploads a new texture.
+class TextureCache
+{
+    public:
+        TextureCache(SDL_Renderer *renderer);
+        ~TextureCache();
+
+        // Upload an image the asset loader already decoded, under path.
+        // The surface stays the caller's. Textures stay resident until the
+        // cache is destroyed, even when nothing references them.
+        bool Adopt(const char *path, SDL_Surface *surface);
+
+        // Every Acquire must be paired with a Release. A miss loads the image
+        // synchronously and logs it, since it means the loader skipped it.
+        Texture *Acquire(const char *path);
+        void Release(Texture *texture);
+
+        Uint32 Hits() const
+        {
+            return mHits;
+        }
+
+        Uint32 Misses() const
+        {
+            return mMisses;
+        }
+
+    private:
+        struct Entry {
+            std::string path;
+            Texture texture;
+        };
+
+        Entry *Find(const char *path);
+        Entry *Load(const char *path);
+        Entry *Create(const char *path, SDL_Surface *surface);
+
+        SDL_Renderer *mRenderer;
+        std::vector<std::unique_ptr<Entry>> mEntries;
+
+        Uint32 mHits;
+        Uint32 mMisses;
+};
+
+#endif
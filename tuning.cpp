@@ -0,0 +1,223 @@
+#include "tuning.h"
+#include "game.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#else
+#include <sys/stat.h>
+#endif
+
+const Tuning TUNING_DEFAULTS = {
+    16.0f,    // shipSpeed
+    0.25f,    // shipThrust
+    0.25f,    // shipDrag
+    4.0f,     // shipRotationSpeed
+    1000.0f,  // shipShootTime
+    3000.0f,  // shipRespawnTime
+    BULLET_SPEED,
+    3000.0f,  // newWaveTime
+    350.0f,   // waveRadius
+    2,        // lives
+};
+
+Tuning gTuning = TUNING_DEFAULTS;
+
+struct TuningField {
+    const char *name;
+    size_t offset;
+    bool integer;
+    float min;
+    float max;
+};
+
+static const TuningField TUNING_FIELDS[] = {
+    {"ship_speed", offsetof(Tuning, shipSpeed), false, 0.5f, 64.0f},
+    {"ship_thrust", offsetof(Tuning, shipThrust), false, 0.01f, 1.0f},
+    {"ship_drag", offsetof(Tuning, shipDrag), false, 0.0f, 16.0f},
+    {"ship_rotation_speed", offsetof(Tuning, shipRotationSpeed), false, 0.0f, 45.0f},
+    {"ship_shoot_time", offsetof(Tuning, shipShootTime), false, 0.0f, 60000.0f},
+    {"ship_respawn_time", offsetof(Tuning, shipRespawnTime), false, 0.0f, 60000.0f},
+    {"bullet_speed", offsetof(Tuning, bulletSpeed), false, 1.0f, 64.0f},
+    {"new_wave_time", offsetof(Tuning, newWaveTime), false, 0.0f, 60000.0f},
+    {"wave_radius", offsetof(Tuning, waveRadius), false, 0.0f, 1000.0f},
+    {"lives", offsetof(Tuning, lives), true, 0.0f, 99.0f},
+};
+
+static char *trim(char *begin, char *end)
+{
+    while(begin < end && (*begin == ' ' || *begin == '\t' || *begin == '\r')) begin++;
+    while(end > begin && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r')) end--;
+    *end = '\0';
+    return begin;
+}
+
+// One `name = value` line, with comments already cut off, onto tuning.
+static bool parseLine(char *line, char *end, Tuning &tuning, const char *path, int lineNumber)
+{
+    char *equals = (char*)memchr(line, '=', end - line);
+    if(equals == nullptr)
+    {
+        fprintf(stderr, "%s:%d: expected name = value\n", path, lineNumber);
+        return false;
+    }
+    char *name = trim(line, equals);
+    char *value = trim(equals + 1, end);
+
+    for(const TuningField &field : TUNING_FIELDS)
+    {
+        if(strcmp(name, field.name) != 0) continue;
+
+        char *parsed;
+        float number = field.integer ? (float)strtol(value, &parsed, 10) : strtof(value, &parsed);
+        if(parsed == value || *parsed != '\0' || !(number >= field.min && number <= field.max))
+        {
+            fprintf(stderr, "%s:%d: %s must be a%s number from %g to %g\n", path, lineNumber, name,
+                    field.integer ? " whole" : "", field.min, field.max);
+            return false;
+        }
+        char *slot = (char*)&tuning + field.offset;
+        if(field.integer) *(int*)slot = (int)number;
+        else *(float*)slot = number;
+        return true;
+    }
+    fprintf(stderr, "%s:%d: unknown setting %s\n", path, lineNumber, name);
+    return false;
+}
+
+bool LoadTuning(const char *path, Tuning &tuning)
+{
+    FILE *file = fopen(path, "rb");
+    if(file == nullptr)
+    {
+        fprintf(stderr, "Unable to open tuning %s\n", path);
+        return false;
+    }
+    char buffer[TUNING_FILE_MAX + 1];
+    size_t size = fread(buffer, 1, sizeof(buffer), file);
+    fclose(file);
+    if(size > TUNING_FILE_MAX)
+    {
+        fprintf(stderr, "Tuning %s is over %d bytes\n", path, TUNING_FILE_MAX);
+        return false;
+    }
+    buffer[size] = '\0';
+
+    // Parsed into a copy, so a bad line leaves every value as it was.
+    Tuning parsed = tuning;
+    bool ok = true;
+    int number = 0;
+    char *line = buffer;
+    while(line < buffer + size)
+    {
+        char *end = (char*)memchr(line, '\n', buffer + size - line);
+        if(end == nullptr) end = buffer + size;
+        number++;
+
+        char *comment = (char*)memchr(line, '#', end - line);
+        char *content = trim(line, comment ? comment : end);
+        if(*content != '\0') ok &= parseLine(content, content + strlen(content), parsed, path, number);
+        line = end + 1;
+    }
+
+    if(ok) tuning = parsed;
+    return ok;
+}
+
+TuningWatcher::TuningWatcher()
+{
+#ifdef __linux__
+    mName = nullptr;
+    mFd = -1;
+#else
+    mPath = nullptr;
+    mModified = 0;
+#endif
+}
+
+TuningWatcher::~TuningWatcher()
+{
+    Stop();
+}
+
+#ifdef __linux__
+
+bool TuningWatcher::Start(const char *path)
+{
+    Stop();
+    const char *slash = strrchr(path, '/');
+    char directory[512];
+    if(slash == nullptr)
+    {
+        strcpy(directory, ".");
+        mName = path;
+    }
+    else
+    {
+        size_t length = slash == path ? 1 : (size_t)(slash - path);
+        if(length >= sizeof(directory)) return false;
+        memcpy(directory, path, length);
+        directory[length] = '\0';
+        mName = slash + 1;
+    }
+
+    mFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if(mFd < 0) return false;
+    if(inotify_add_watch(mFd, directory, IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+    {
+        Stop();
+        return false;
+    }
+    return true;
+}
+
+void TuningWatcher::Stop()
+{
+    if(mFd >= 0) close(mFd);
+    mFd = -1;
+}
+
+bool TuningWatcher::Changed()
+{
+    if(mFd < 0) return false;
+    alignas(inotify_event) char buffer[4096];
+    bool changed = false;
+    ssize_t size;
+    while((size = read(mFd, buffer, sizeof(buffer))) > 0)
+    {
+        for(char *p = buffer; p < buffer + size;)
+        {
+            const inotify_event *event = (const inotify_event*)p;
+            if(event->len > 0 && strcmp(event->name, mName) == 0) changed = true;
+            p += sizeof(inotify_event) + event->len;
+        }
+    }
+    return changed;
+}
+
+#else
+
+bool TuningWatcher::Start(const char *path)
+{
+    struct stat info;
+    mPath = path;
+    mModified = stat(path, &info) == 0 ? info.st_mtime : 0;
+    return true;
+}
+
+void TuningWatcher::Stop()
+{
+    mPath = nullptr;
+}
+
+bool TuningWatcher::Changed()
+{
+    struct stat info;
+    if(mPath == nullptr || stat(mPath, &info) != 0 || info.st_mtime == mModified) return false;
+    mModified = info.st_mtime;
+    return true;
+}
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef TUNING_H
+#define TUNING_H
+
+#include <stddef.h>
+#include <time.h>
+
+// Balance values the simulation reads every time it needs one, so a
+// change takes effect from the next tick. The defaults are the values the
+// game was built around.
+struct Tuning {
+    // Top speed, in pixels per tick on each axis, and the share of it
+    // thrust gives straight away.
+    float shipSpeed;
+    float shipThrust;
+    // Speed lost per tick on each axis while coasting.
+    float shipDrag;
+    // Degrees per tick.
+    float shipRotationSpeed;
+    // Milliseconds between shots and before a destroyed ship returns.
+    float shipShootTime;
+    float shipRespawnTime;
+    float bulletSpeed;
+    // Milliseconds between clearing a wave and the next one, and how far
+    // from the centre its big asteroids start.
+    float newWaveTime;
+    float waveRadius;
+    // Lives at the start of a game.
+    int lives;
+};
+
+extern const Tuning TUNING_DEFAULTS;
+extern Tuning gTuning;
+
+// Largest tuning file read.
+#define TUNING_FILE_MAX 4096
+
+// Reads path over tuning. Each line is `name = value`, # starts a comment,
+// and the names are the Tuning fields in snake case, such as ship_speed.
+// Names left out keep their value. False, with tuning untouched, when the
+// file can't be read or any line is unknown, malformed or out of range;
+// the reasons go to stderr. The file is parsed in place in a fixed buffer,
+// so nothing is allocated past opening it.
+bool LoadTuning(const char *path, Tuning &tuning);
+
+// Reports when a file is written. On Linux inotify watches the file's
+// directory, since editors often save by renaming a new file over the
+// old one; elsewhere the modification time is polled.
+class TuningWatcher
+{
+    public:
+        TuningWatcher();
+        ~TuningWatcher();
+
+        // path is kept, not copied.
+        bool Start(const char *path);
+        void Stop();
+        // Whether the file changed since the last call. Never blocks.
+        bool Changed();
+
+    private:
+#ifdef __linux__
+        const char *mName;
+        int mFd;
+#else
+        const char *mPath;
+        time_t mModified;
+#endif
+};
+
+#endif
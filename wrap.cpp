@@ -0,0 +1,27 @@
+#include "wrap.h"
+
+void GhostList::Reserve(size_t count)
+{
+    if(mSeams.size() < count) mSeams.resize(count);
+    mGhosts.reserve(count * 3);
+}
+
+void GhostList::Build(const float *x, const float *y, const int *w, const int *h, size_t count, float width, float height)
+{
+    if(mSeams.size() < count) mSeams.resize(count);
+    uint8_t *seams = mSeams.data();
+    for(size_t i=0; i < count; i++)
+    {
+        seams[i] = BoxSeams(x[i], y[i], w[i], h[i], width, height);
+    }
+
+    mGhosts.clear();
+    for(size_t i=0; i < count; i++)
+    {
+        if(seams[i] == 0) continue;
+        uint32_t id = (uint32_t)i;
+        if(seams[i] & WRAP_SEAM_X) mGhosts.push_back({id, -width, 0.0f});
+        if(seams[i] & WRAP_SEAM_Y) mGhosts.push_back({id, 0.0f, -height});
+        if(seams[i] == (WRAP_SEAM_X | WRAP_SEAM_Y)) mGhosts.push_back({id, -width, -height});
+    }
+}
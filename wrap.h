@@ -0,0 +1,63 @@
+#ifndef WRAP_H
+#define WRAP_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+// The playfield is a torus: entities keep their top-left corner inside
+// [0, width) x [0, height), and whatever hangs past the right or bottom
+// edge shows, and collides, one playfield back across the seam. An entity
+// crossing both seams has three ghosts, one each across the left and top
+// edges and one in the opposite corner, so it takes four copies in all.
+#define WRAP_SEAM_X 1
+#define WRAP_SEAM_Y 2
+
+// Which seams a box with its corner in the playfield runs over.
+inline uint8_t BoxSeams(float x, float y, int w, int h, float width, float height)
+{
+    return (uint8_t)((x + w > width) | ((y + h > height) << 1));
+}
+
+// A copy of entity id drawn or collided at its position plus (dx, dy).
+struct Ghost {
+    uint32_t id;
+    float dx;
+    float dy;
+};
+
+// The ghosts of a whole struct-of-arrays pool, rebuilt in bulk: one
+// branch-free pass finds every entity's seams, then a pass over those
+// bytes lists the few entities that cross one. Draws and collision tests
+// run over the short list instead of testing the seams per entity.
+class GhostList
+{
+    public:
+        // Size the buffers for count entities so Build never allocates.
+        void Reserve(size_t count);
+
+        void Build(const float *x, const float *y, const int *w, const int *h, size_t count, float width, float height);
+
+        // WRAP_SEAM_ bits per entity, as of the last Build.
+        const uint8_t *Seams() const
+        {
+            return mSeams.data();
+        }
+
+        const std::vector<Ghost> &Ghosts() const
+        {
+            return mGhosts;
+        }
+
+        // Bytes of storage held.
+        size_t Memory() const
+        {
+            return mSeams.capacity() * sizeof(uint8_t) + mGhosts.capacity() * sizeof(Ghost);
+        }
+
+    private:
+        std::vector<uint8_t> mSeams;
+        std::vector<Ghost> mGhosts;
+};
+
+#endif